@@ -0,0 +1,117 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QGuiApplication>
+#include <QScreen>
+
+#include "AnimationScheduler.h"
+
+static const qint64 NsecsPerStep = qint64(AnimationScheduler::StepInterval) * 1000000;
+
+AnimationScheduler::AnimationScheduler(QObject *parent)
+  : QObject(parent),
+    _surface(0),
+    _frameInterval(0),
+    _lastTick(0),
+    _remainder(0),
+    _stepAngle(0),
+    _statistics(QStringLiteral("animation"))
+{
+  _fallback.setSingleShot(true);
+  connect(&_fallback, SIGNAL(timeout()), this, SLOT(tick()));
+}
+
+void AnimationScheduler::setSurface(QObject *surface)
+{
+  if (_surface == surface) {
+    return;
+  }
+  if (_surface) {
+    disconnect(_surface, SIGNAL(frameSwapped()), this, SLOT(tick()));
+  }
+  _surface = surface;
+  if (_surface) {
+    connect(_surface, SIGNAL(frameSwapped()), this, SLOT(tick()));
+  }
+}
+
+void AnimationScheduler::start()
+{
+  const QScreen *screen = QGuiApplication::primaryScreen();
+  const qreal refreshRate = (screen && screen->refreshRate() > 0) ? screen->refreshRate() : 60;
+  _frameInterval = qint64(1.0e9 / refreshRate);
+  _fallback.setInterval(qMax(1, int(2000 / refreshRate)));
+
+  _clock.start();
+  _lastTick = 0;
+  _remainder = 0;
+  _fallback.start();
+}
+
+void AnimationScheduler::tick()
+{
+  if (!_clock.isValid()) {
+    return;
+  }
+
+  const qint64 now = _clock.nsecsElapsed();
+  const qint64 interval = now - _lastTick;
+  _statistics.record(FrameStatistics::FrameInterval, interval);
+  if (sender() == &_fallback) {
+    //nothing was presented, so no frame was late either
+    _statistics.add(FrameStatistics::FallbackTicks);
+  }
+  else {
+    _statistics.add(FrameStatistics::Ticks);
+    if (interval > _frameInterval * 3 / 2) {
+      _statistics.add(FrameStatistics::LateTicks);
+      _statistics.add(FrameStatistics::DroppedFrames, int(qMax(Q_INT64_C(1), (interval + _frameInterval / 2) / _frameInterval - 1)));
+    }
+  }
+  _remainder += interval * _stepAngle;
+  _lastTick = now;
+  const qint64 angle = _remainder / NsecsPerStep;
+  _remainder -= angle * NsecsPerStep;
+
+  _fallback.start();
+  if (angle != 0) {
+    emit advance(int(angle));
+  }
+}
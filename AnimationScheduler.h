@@ -0,0 +1,94 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ANIMATIONSCHEDULER_H
+#define ANIMATIONSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include "FrameStatistics.h"
+
+// Steps an animation once per frame presented by a surface instead of on a fixed timer. The time
+// since the previous frame is turned into an angle at stepAngle() per StepInterval milliseconds,
+// the speed the 20 ms timer used to give, and the whole part is emitted with advance(); the rest
+// is carried over, so the motion is equally fast and smooth at any refresh rate.
+//
+// A surface only presents another frame if advance() changed something, so a fallback timer of
+// two frame intervals keeps the animation going while nothing is painted.
+//
+// statistics() holds the intervals between ticks and counts the ticks that came more than half a
+// refresh interval late, with the frames that were dropped in between.
+class AnimationScheduler : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum { StepInterval = 20 };
+
+  explicit AnimationScheduler(QObject *parent = 0);
+
+  // a QOpenGLWidget or QOpenGLWindow, advance() follows its frameSwapped()
+  void setSurface(QObject *surface);
+  int stepAngle() const { return _stepAngle; }
+  void setStepAngle(int angle) { _stepAngle = angle; }
+  void start();
+  const FrameStatistics &statistics() const { return _statistics; }
+
+signals:
+  void advance(int angle);
+
+private slots:
+  void tick();
+
+private:
+  QObject *_surface;
+  QTimer _fallback;
+  QElapsedTimer _clock;
+  qint64 _frameInterval;
+  qint64 _lastTick;
+  //angle * nanoseconds not emitted yet
+  qint64 _remainder;
+  int _stepAngle;
+  FrameStatistics _statistics;
+};
+
+#endif
@@ -0,0 +1,409 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLTimerQuery>
+#include <QScopedPointer>
+#include <QSurfaceFormat>
+#include <QDebug>
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "CubeRenderer.h"
+#include "FrameCapture.h"
+#include "FramePipeline.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+#include "ProgramCache.h"
+#include "SharedResources.h"
+#include "TransformBatch.h"
+
+Benchmark::Benchmark()
+  : _frames(1000),
+    _warmupFrames(50),
+    _size(256, 256)
+{
+  for (int i = 0; i < ParameterStorage::BackendCount; ++i) {
+    _backends << static_cast<ParameterStorage::Backend>(i);
+  }
+  for (int i = 0; i < ParameterEncoding::EncodingCount; ++i) {
+    _encodings << static_cast<ParameterEncoding::Encoding>(i);
+  }
+}
+
+int Benchmark::run()
+{
+  QJsonObject report;
+  report["frames"] = _frames;
+  report["warmupFrames"] = _warmupFrames;
+  report["width"] = _size.width();
+  report["height"] = _size.height();
+  report["captureDirectory"] = FrameCapture::isEnabled() ? QJsonValue(FrameCapture::directory()) : QJsonValue();
+
+  QJsonArray results;
+  foreach (ParameterStorage::Backend backend, _backends) {
+    foreach (ParameterEncoding::Encoding encoding, _encodings) {
+      if (!ParameterStorage::supportsEncoding(backend, encoding)) {
+        continue;
+      }
+      qDebug() << "Benchmarking" << ParameterStorage::backendName(backend) << "storage with"
+               << ParameterEncoding::encodingName(encoding) << "encoding";
+      results.append(runBackend(backend, encoding));
+    }
+  }
+  report["backends"] = results;
+  return write(report) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Benchmark::runTransforms()
+{
+  const int instances = CubeRenderer::selectedInstanceCount() > 1 ? CubeRenderer::selectedInstanceCount() : int(DefaultTransformInstances);
+  QJsonObject report;
+  report["instances"] = instances;
+  report["frames"] = _frames;
+  report["warmupFrames"] = _warmupFrames;
+  report["bestKernel"] = TransformBatch::kernelName(TransformBatch::bestKernel());
+
+  //the instance grid of CubeRenderer
+  const int side = int(ceil(sqrt(double(instances))));
+  const float cell = 1.0f / side;
+  TransformBatch batch;
+  batch.resize(instances);
+  for (int i = 0; i < instances; ++i) {
+    batch.setInstance(i, QVector3D(-0.5f + (i % side + 0.5f) * cell, -0.5f + (i / side + 0.5f) * cell, -10.0f),
+                      cell, QVector3D(7.0f * i, 7.0f * i, 0.0f));
+  }
+
+  QVector<GLfloat> reference(instances * ParameterStorage::SlotFloats, 0.0f);
+  QVector<GLfloat> records(instances * ParameterStorage::SlotFloats, 0.0f);
+  const int offset = ParameterLayout::offset(ParameterLayout::RotMatrix);
+  const int totalFrames = _warmupFrames + _frames;
+  QElapsedTimer timer;
+  QJsonArray results;
+
+  QVector<double> times;
+  for (int frame = 0; frame < totalFrames; ++frame) {
+    const float angle = 2.0f * frame;
+    timer.start();
+    for (int i = 0; i < instances; ++i) {
+      QMatrix4x4 m;
+      m.translate(-0.5f + (i % side + 0.5f) * cell, -0.5f + (i / side + 0.5f) * cell, -10.0f);
+      m.scale(cell);
+      m.rotate(angle + 7.0f * i, 1.0f, 0.0f, 0.0f);
+      m.rotate(angle + 7.0f * i, 0.0f, 1.0f, 0.0f);
+      m.rotate(-angle, 0.0f, 0.0f, 1.0f);
+      ParameterLayout::setRotMatrix(reference.data() + i * ParameterStorage::SlotFloats, m);
+    }
+    if (frame >= _warmupFrames) {
+      times << double(timer.nsecsElapsed()) / instances;
+    }
+  }
+  QJsonObject qmatrix;
+  qmatrix["kernel"] = QStringLiteral("qmatrix4x4");
+  qmatrix["nsPerInstance"] = summarize(times);
+  results.append(qmatrix);
+
+  for (int k = 0; k < TransformBatch::KernelCount; ++k) {
+    const TransformBatch::Kernel kernel = static_cast<TransformBatch::Kernel>(k);
+    if (!TransformBatch::isSupported(kernel)) {
+      continue;
+    }
+    times.clear();
+    for (int frame = 0; frame < totalFrames; ++frame) {
+      const float angle = 2.0f * frame;
+      timer.start();
+      batch.compute(QVector3D(angle, angle, -angle), records.data() + offset, ParameterStorage::SlotFloats, kernel);
+      if (frame >= _warmupFrames) {
+        times << double(timer.nsecsElapsed()) / instances;
+      }
+    }
+
+    //both hold the matrices of the last frame
+    double maxError = 0.0;
+    for (int i = 0; i < records.count(); ++i) {
+      maxError = qMax(maxError, double(qAbs(records[i] - reference[i])));
+    }
+    QJsonObject result;
+    result["kernel"] = TransformBatch::kernelName(kernel);
+    result["nsPerInstance"] = summarize(times);
+    result["maxError"] = maxError;
+    results.append(result);
+  }
+  report["kernels"] = results;
+  return write(report) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+bool Benchmark::write(const QJsonObject &report)
+{
+  QFile output;
+  bool opened;
+  if (_outputFile.isEmpty()) {
+    opened = output.open(stdout, QIODevice::WriteOnly);
+  }
+  else {
+    output.setFileName(_outputFile);
+    opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+  }
+  if (!opened) {
+    qWarning() << "Could not open benchmark output" << _outputFile << output.errorString();
+    return false;
+  }
+  output.write(QJsonDocument(report).toJson());
+  return true;
+}
+
+QJsonObject Benchmark::runBackend(ParameterStorage::Backend backend, ParameterEncoding::Encoding encoding)
+{
+  QJsonObject result;
+  result["backend"] = ParameterStorage::backendName(backend);
+  result["encoding"] = ParameterEncoding::encodingName(encoding);
+
+  QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+  ParameterStorage::requestFormat(backend, format);
+
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+
+  QOpenGLContext context;
+  context.setFormat(format);
+  if (!context.create() || !context.makeCurrent(&surface)) {
+    result["error"] = QStringLiteral("could not create an OpenGL context");
+    return result;
+  }
+
+  QOpenGLFunctions *f = context.functions();
+  result["vendor"] = QString::fromLatin1(reinterpret_cast<const char *>(f->glGetString(GL_VENDOR)));
+  result["renderer"] = QString::fromLatin1(reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)));
+  result["version"] = QString::fromLatin1(reinterpret_cast<const char *>(f->glGetString(GL_VERSION)));
+
+  if (!ParameterStorage::isSupported(backend, &context)) {
+    result["supported"] = false;
+    context.doneCurrent();
+    return result;
+  }
+  result["supported"] = true;
+
+  QVector<double> cpuTimes;
+  QVector<double> gpuTimes;
+  QVector<double> prepareTimes;
+  QVector<double> uploadTimes;
+  QVector<double> uploadBytes;
+  QVector<double> stateCalls;
+  QVector<double> skippedStateCalls;
+  {
+    QOpenGLFramebufferObject fbo(_size, QOpenGLFramebufferObject::CombinedDepthStencil);
+    fbo.bind();
+
+    //run twice to compare a cold start with one that loads the program from the binary cache
+    const ProgramCache::Statistics cacheBefore = ProgramCache::instance()->statistics();
+    QElapsedTimer initTimer;
+    initTimer.start();
+    CubeRenderer renderer(QStringLiteral(":/images/side1.png"), backend, CubeRenderer::selectedInstanceCount(), encoding);
+    renderer.setName(QStringLiteral("benchmark"));
+    //every measured frame is drawn with its programs, so the compile is part of the initialization
+    const bool initialized = renderer.initialize();
+    if (initialized) {
+      renderer.waitForPrograms();
+    }
+    result["initializeMs"] = initTimer.nsecsElapsed() / 1.0e6;
+    const ProgramCache::Statistics &cacheAfter = ProgramCache::instance()->statistics();
+    result["programCacheHit"] = cacheAfter.hits > cacheBefore.hits;
+    result["programCacheHits"] = cacheAfter.hits - cacheBefore.hits;
+    result["programCacheMisses"] = cacheAfter.misses - cacheBefore.misses;
+    result["programLoadMs"] = (cacheAfter.loadTime - cacheBefore.loadTime) / 1.0e6;
+    result["programCompileMs"] = (cacheAfter.compileTime - cacheBefore.compileTime) / 1.0e6;
+    if (!initialized || !renderer.isReady()) {
+      result["error"] = QStringLiteral("could not initialize the renderer");
+      context.doneCurrent();
+      return result;
+    }
+    renderer.resize(_size.width(), _size.height());
+    result["instances"] = renderer.instanceCount();
+    result["batches"] = renderer.storage()->batchCount();
+    result["bytesPerSlot"] = renderer.storage()->encoding().slotBytes();
+    result["mesh"] = renderer.mesh()->name();
+    result["vertexFormat"] = Mesh::vertexFormatName(renderer.vertexFormat());
+    result["bytesPerVertex"] = Mesh::vertexStride(renderer.vertexFormat());
+    result["triangles"] = renderer.mesh()->indexCount() / 3;
+
+    //timer query results are read QueryCount frames late so that they are normally available
+    QOpenGLTimerQuery queries[QueryCount];
+    bool gpuTiming = !context.isOpenGLES();
+    for (int i = 0; gpuTiming && i < QueryCount; ++i) {
+      gpuTiming = queries[i].create();
+    }
+
+    CubeState state;
+    state.clearColor = QColor(Qt::darkBlue);
+    result["materialPermutation"] = Material::permutationName(renderer.permutation(state));
+    //the measured frames are captured, so the CPU frame time includes the cost of the readback
+    QScopedPointer<FrameCapture> capture;
+    if (FrameCapture::isEnabled()) {
+      capture.reset(new FrameCapture(QString("benchmark-%1-%2").arg(ParameterStorage::backendName(backend),
+                                                                    ParameterEncoding::encodingName(encoding))));
+    }
+    const int totalFrames = _warmupFrames + _frames;
+    QElapsedTimer cpuTimer;
+    for (int frame = 0; frame < totalFrames; ++frame) {
+      QOpenGLTimerQuery &query = queries[frame % QueryCount];
+      if (gpuTiming && frame - QueryCount >= _warmupFrames) {
+        gpuTimes << query.waitForResult() / 1.0e6;
+      }
+
+      state.xRot += 32;
+      state.yRot += 32;
+      state.zRot -= 32;
+
+      //as the widgets do, where Qt changes the bindings between frames
+      GLStateCache *stateCache = GLStateCache::current();
+      stateCache->invalidate();
+      const GLStateCache::Statistics stateBefore = stateCache->statistics();
+
+      cpuTimer.start();
+      if (gpuTiming) {
+        query.begin();
+      }
+      renderer.render(state);
+      if (gpuTiming) {
+        query.end();
+      }
+      if (capture && frame >= _warmupFrames) {
+        capture->capture(QRect(QPoint(0, 0), _size));
+      }
+      //as the widgets do, the next frame is known before this one reaches the GPU
+      CubeState next = state;
+      next.xRot += 32;
+      next.yRot += 32;
+      next.zRot -= 32;
+      renderer.prepare(next);
+      f->glFlush();
+      const qint64 cpuTime = cpuTimer.nsecsElapsed();
+
+      if (frame >= _warmupFrames) {
+        cpuTimes << cpuTime / 1.0e6;
+        prepareTimes << renderer.lastPrepareTime() / 1.0e3;
+        uploadTimes << renderer.lastUploadTime() / 1.0e3;
+        uploadBytes << renderer.lastUploadBytes();
+        stateCalls << stateCache->statistics().issued - stateBefore.issued;
+        skippedStateCalls << stateCache->statistics().skipped - stateBefore.skipped;
+      }
+    }
+    f->glFinish();
+    for (int frame = qMax(totalFrames - QueryCount, _warmupFrames); gpuTiming && frame < totalFrames; ++frame) {
+      gpuTimes << queries[frame % QueryCount].waitForResult() / 1.0e6;
+    }
+
+    result["fenceWaits"] = renderer.storage()->fenceWaitCount();
+    //the texture may still be the placeholder if its image took longer than the frames
+    result["gpuMemoryBytes"] = SharedResources::current()->memory()->ownerBytes(renderer.name());
+    result["parameterStorageBytes"] = renderer.storage()->allocatedBytes();
+    if (renderer.pipeline()) {
+      const FramePipeline::Statistics &statistics = renderer.pipeline()->statistics();
+      QJsonObject frames;
+      frames["ready"] = statistics.ready;
+      frames["waited"] = statistics.waited;
+      frames["missed"] = statistics.missed;
+      frames["dropped"] = statistics.dropped;
+      result["prepareThreads"] = FramePipeline::threadCount();
+      result["preparedFrames"] = frames;
+    }
+    if (capture) {
+      capture->finish();
+      const FrameCapture::Statistics statistics = capture->statistics();
+      QJsonObject captured;
+      captured["captured"] = statistics.captured;
+      captured["written"] = statistics.written;
+      captured["stalls"] = statistics.stalls;
+      captured["dropped"] = statistics.dropped;
+      result["capture"] = captured;
+    }
+    renderer.destroy();
+    fbo.release();
+  }
+  context.doneCurrent();
+
+  result["cpuFrameMs"] = summarize(cpuTimes);
+  result["gpuFrameMs"] = gpuTimes.isEmpty() ? QJsonValue() : QJsonValue(summarize(gpuTimes));
+  result["prepareUs"] = summarize(prepareTimes);
+  result["uploadUs"] = summarize(uploadTimes);
+  result["uploadBytesPerFrame"] = summarize(uploadBytes);
+  result["glStateCallsPerFrame"] = summarize(stateCalls);
+  result["glStateCallsSkippedPerFrame"] = summarize(skippedStateCalls);
+  return result;
+}
+
+QJsonObject Benchmark::summarize(QVector<double> samples)
+{
+  QJsonObject summary;
+  summary["count"] = samples.count();
+  if (samples.isEmpty()) {
+    return summary;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  double sum = 0.0;
+  foreach (double sample, samples) {
+    sum += sample;
+  }
+
+  //nearest-rank percentile
+  const int count = samples.count();
+  const int percentiles[] = { 50, 90, 95, 99 };
+  summary["mean"] = sum / count;
+  summary["min"] = samples.first();
+  summary["max"] = samples.last();
+  for (int i = 0; i < 4; ++i) {
+    int rank = qBound(0, (percentiles[i] * count + 99) / 100 - 1, count - 1);
+    summary[QString("p%1").arg(percentiles[i])] = samples[rank];
+  }
+  return summary;
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include "ParameterStorage.h"
+
+// Renders the cube scene offscreen into an FBO for a number of frames per storage backend and
+// parameter encoding, and reports CPU frame time, GPU frame time, parameter upload time and
+// parameter bytes per frame as JSON. runTransforms() instead times the instance matrices alone,
+// the QMatrix4x4 calls against every TransformBatch kernel the CPU supports.
+//
+// While FrameCapture is enabled the measured frames are also captured, which makes the benchmark
+// the headless way of recording frames and of measuring what capture costs.
+class Benchmark
+{
+public:
+  Benchmark();
+
+  void setFrameCount(int frames) { _frames = frames; }
+  void setWarmupFrameCount(int frames) { _warmupFrames = frames; }
+  void setSize(const QSize &size) { _size = size; }
+  void setBackends(const QList<ParameterStorage::Backend> &backends) { _backends = backends; }
+  void setEncodings(const QList<ParameterEncoding::Encoding> &encodings) { _encodings = encodings; }
+  void setOutputFile(const QString &fileName) { _outputFile = fileName; }
+
+  int run();
+  int runTransforms();
+
+private:
+  enum { QueryCount = 4, DefaultTransformInstances = 10000 };
+
+  QJsonObject runBackend(ParameterStorage::Backend backend, ParameterEncoding::Encoding encoding);
+  bool write(const QJsonObject &report);
+  static QJsonObject summarize(QVector<double> samples);
+
+  int _frames;
+  int _warmupFrames;
+  QSize _size;
+  QList<ParameterStorage::Backend> _backends;
+  QList<ParameterEncoding::Encoding> _encodings;
+  QString _outputFile;
+};
+
+#endif
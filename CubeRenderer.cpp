@@ -0,0 +1,609 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QMap>
+#include <QStringList>
+#include <QDebug>
+
+#include <math.h>
+
+#include "CubeRenderer.h"
+#include "FramePipeline.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+#include "GpuProfiler.h"
+#include "ShaderCompiler.h"
+#include "SharedResources.h"
+#include "TextureLoader.h"
+
+#define PROGRAM_VERTEX_ATTRIBUTE 0
+#define PROGRAM_TEXCOORD_ATTRIBUTE 1
+
+int CubeRenderer::_selectedInstanceCount = 1;
+bool CubeRenderer::_textureArrayEnabled = false;
+
+//the layers of the texture array
+static QStringList arrayImagePaths()
+{
+  QStringList paths;
+  for (int i = 1; i <= 6; ++i) {
+    paths << QString(":/images/side%1.png").arg(i);
+  }
+  return paths;
+}
+
+//the material of the record in slot index: the single cube's material follows rotIndex, instances alternate
+static Material::Id instanceMaterial(int index)
+{
+  return (index & 1) ? Material::Blue : Material::Red;
+}
+
+//bounds the time a frame spends uploading textures that finished decoding
+static const int MaxTextureUploadsPerFrame = 2;
+
+CubeRenderer::CubeRenderer(const QString &texturePath, ParameterStorage::Backend backend, int instanceCount,
+                           ParameterEncoding::Encoding encoding)
+  : _backend(backend),
+    _encoding(encoding),
+    _vertexFormat(Mesh::selectedVertexFormat()),
+    _texturePath(texturePath),
+    _name(texturePath),
+    _instanceCount(qMax(1, instanceCount)),
+    _f(0),
+    _state(0),
+    _textureLoader(0),
+    _memory(0),
+    _storage(0),
+    _profiler(0),
+    _layer(0),
+    _layerCount(1),
+    _pipeline(0),
+    _programsReady(false),
+    _programsFailed(false),
+    _recordsUploaded(false),
+    _prepareTime(0),
+    _uploadTime(0),
+    _uploadBytes(0)
+{
+}
+
+CubeRenderer::~CubeRenderer()
+{
+  destroy();
+}
+
+bool CubeRenderer::initialize()
+{
+  initializeOpenGLFunctions();
+  _f = QOpenGLContext::currentContext()->extraFunctions();
+
+  //create VAO
+  _vao.create();
+  _vao.bind();
+
+  if (!makeObject()) {
+    return false;
+  }
+
+  if (_instanceCount == 1) {
+    _storage = ParameterStorage::create(_backend, ParameterStorage::SlotCount, _encoding);
+  }
+  else {
+    //the storage may not be able to hold every instance
+    _storage = ParameterStorage::create(_backend, _instanceCount, _encoding);
+    _instanceCount = _storage->capacity();
+
+    //lay the instances out on a square grid, each one spinning with its own phase
+    const int side = int(ceil(sqrt(double(_instanceCount))));
+    const float cell = 1.0f / side;
+    for (int layout = 0; layout < 2; ++layout) {
+      const float scale = (layout == 0) ? cell : 0.5f * cell;
+      _transforms[layout].resize(_instanceCount);
+      for (int i = 0; i < _instanceCount; ++i) {
+        const float phase = 7.0f * i;
+        _transforms[layout].setInstance(i, QVector3D(-0.5f + (i % side + 0.5f) * cell, -0.5f + (i / side + 0.5f) * cell, -10.0f),
+                                        scale, QVector3D(phase, phase, 0.0f));
+      }
+    }
+    _pipeline = new FramePipeline(_instanceCount, ParameterStorage::SlotFloats,
+                                  [this](const CubeState &state, int first, int count, GLfloat *records) {
+                                    prepareInstances(state, first, count, records);
+                                  });
+  }
+  //the record of the single cube
+  _buffer.resize(ParameterStorage::SlotFloats);
+
+  QString vsrc =
+      "#ifdef GL_ES\n"
+      "precision mediump float;\n"
+      "precision mediump sampler2D;\n"
+      "#endif\n"
+      "in vec4 vertex;\n"
+      "in vec2 texCoord;\n"
+      "flat out int materialID;\n"
+      "flat out int layerID;\n"
+      "out vec2 texc;\n"
+      "uniform int rotIndex;\n"
+      "uniform mat4 projection;\n"
+      //maps the normalized short positions of the compact formats back to the mesh
+      "const float positionScale = " + QString::number(_mesh->positionScale(_vertexFormat), 'f', 8) + ";\n"
+      "\n";
+  vsrc += _storage->vertexShaderSource();
+  vsrc +=
+      "\n"
+      "int getRotationIndex(void) { return rotIndex + gl_InstanceID; }\n";
+  vsrc += ParameterLayout::glslCurrentAccessors();
+  vsrc +=
+      "\n"
+      "void main(void)\n"
+      "{\n"
+      "    mat4 rotMatrix = getRotationMatrix();\n"
+      "    gl_Position = projection * rotMatrix * vec4(vertex.xyz * positionScale, 1.0);\n"
+      "    materialID = getMaterialId();\n"
+      "    layerID = getLayer();\n"
+      "    texc = texCoord;\n"
+      "}\n";
+
+  QString fsrc =
+      "#ifdef GL_ES\n"
+      "precision mediump float;\n"
+      "precision mediump sampler2D;\n"
+      "precision mediump sampler2DArray;\n"
+      "precision mediump isampler2D;\n"
+      "#endif\n"
+      "in vec2 texc;\n"
+      "flat in int layerID;\n"
+      "out vec4 fragColor;\n";
+  if (_textureArrayEnabled) {
+    fsrc +=
+        "uniform sampler2DArray tex;\n"
+        "vec4 getTexel(void) { return texture(tex, vec3(texc, float(layerID))); }\n";
+  }
+  else {
+    fsrc +=
+        "uniform sampler2D tex;\n"
+        "vec4 getTexel(void) { return texture(tex, texc); }\n";
+  }
+  //the material is specialised by the defines of the permutation
+  fsrc += Material::glslShading();
+  fsrc +=
+      "void main(void)\n"
+      "{\n"
+      "  fragColor = shade(getTexel());\n"
+      "}\n";
+
+  vsrc.prepend(_storage->glslVersion());
+
+  //the vertex layout is VAO state, the VAO is bound and so are the vertex and index buffers;
+  //QOpenGLShaderProgram::setAttributeBuffer() cannot ask for normalized integers
+  const int stride = Mesh::vertexStride(_vertexFormat);
+  const Mesh::Attribute position = Mesh::positionAttribute(_vertexFormat);
+  const Mesh::Attribute texCoord = Mesh::texCoordAttribute(_vertexFormat);
+  glEnableVertexAttribArray(PROGRAM_VERTEX_ATTRIBUTE);
+  glEnableVertexAttribArray(PROGRAM_TEXCOORD_ATTRIBUTE);
+  glVertexAttribPointer(PROGRAM_VERTEX_ATTRIBUTE, position.tupleSize, position.type, position.normalized, stride,
+                        reinterpret_cast<const void *>(qintptr(position.offset)));
+  glVertexAttribPointer(PROGRAM_TEXCOORD_ATTRIBUTE, texCoord.tupleSize, texCoord.type, texCoord.normalized, stride,
+                        reinterpret_cast<const void *>(qintptr(texCoord.offset)));
+
+  QMap<QByteArray, int> attributeLocations;
+  attributeLocations.insert("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+  attributeLocations.insert("texCoord", PROGRAM_TEXCOORD_ATTRIBUTE);
+  //a program for the material permutation of either rotIndex, both read the same storage; all of
+  //them are submitted before any is waited for, so they compile side by side
+  for (int rotIndex = 0; rotIndex < 2; ++rotIndex) {
+    const Material::Set key = Material::permutation(materials(rotIndex));
+    if (_permutations.contains(key)) {
+      continue;
+    }
+
+    //every renderer with the same backend, capacity and permutation generates the same sources and shares the program
+    Permutation permutation;
+    permutation.program = SharedResources::current()->program(
+        vsrc, QString::fromLatin1(_storage->glslVersion() + Material::permutationDefines(key)) + fsrc, attributeLocations);
+    if (!permutation.program) {
+      return false;
+    }
+    permutation.rotIndexLocation = -1;
+    _permutations.insert(key, permutation);
+  }
+
+  if (GpuProfiler::isEnabled()) {
+    _profiler = new GpuProfiler;
+    if (!_profiler->initialize()) {
+      delete _profiler;
+      _profiler = 0;
+    }
+  }
+
+  _vao.release();
+  _state = GLStateCache::current();
+  //programs still compiling are set up by render() once they are done
+  setUpPrograms(false);
+  if (_programsFailed) {
+    return false;
+  }
+  //the Qt wrappers above bound objects behind the cache's back
+  _state->invalidate();
+  return true;
+}
+
+bool CubeRenderer::setUpPrograms(bool wait)
+{
+  if (_programsReady || _programsFailed) {
+    return _programsReady;
+  }
+  ShaderCompiler *compiler = SharedResources::current()->shaderCompiler();
+  //nothing is set up until every permutation is linked, the storage needs all of them
+  for (QHash<Material::Set, Permutation>::const_iterator it = _permutations.constBegin(); it != _permutations.constEnd(); ++it) {
+    const ShaderCompiler::Status status = compiler->poll(it->program.data(), wait);
+    if (status == ShaderCompiler::Failed) {
+      qWarning() << "Could not build the shader programs of" << _name;
+      _programsFailed = true;
+      return false;
+    }
+    if (status == ShaderCompiler::Pending) {
+      return false;
+    }
+  }
+
+  //the records only hold the model matrix, which keeps them affine for the compact encodings
+  QMatrix4x4 projection;
+  projection.ortho(-0.5f, +0.5f, +0.5f, -0.5f, 4.0f, 15.0f);
+  bool first = true;
+  for (QHash<Material::Set, Permutation>::iterator it = _permutations.begin(); it != _permutations.end(); ++it) {
+    Permutation &permutation = it.value();
+    //uniforms that are the same for every frame and every renderer sharing the program
+    permutation.program->bind();
+    permutation.program->setUniformValue("tex", 0);
+    permutation.program->setUniformValue("projection", projection);
+    if (it.key() == Material::Uber) {
+      Material::setTableUniforms(permutation.program.data());
+    }
+    permutation.rotIndexLocation = permutation.program->uniformLocation("rotIndex");
+
+    const bool initialized = first ? _storage->initialize(permutation.program.data())
+                                   : _storage->initializeProgram(permutation.program.data());
+    if (!initialized) {
+      qWarning() << "Could not initialize" << _storage->name() << "shader parameter storage.";
+      _programsFailed = true;
+      return false;
+    }
+    first = false;
+  }
+  _memory->track(_storage, GpuMemory::Parameters, _name + QStringLiteral(" parameters"), _storage->allocatedBytes());
+  _memory->addOwner(_storage, _name);
+
+  //the program and storage setup bound objects behind the cache's back
+  _state->invalidate();
+  _programsReady = true;
+  return true;
+}
+
+void CubeRenderer::waitForPrograms()
+{
+  setUpPrograms(true);
+}
+
+void CubeRenderer::destroy()
+{
+  if (_memory) {
+    _memory->removeOwner(_texture.data(), _name);
+    _memory->removeOwner(_vertexBuffer.data(), _name);
+    _memory->removeOwner(_indexBuffer.data(), _name);
+    _memory->untrack(_storage);
+    _memory = 0;
+  }
+  //waits for the frames the workers are still preparing
+  delete _pipeline;
+  _pipeline = 0;
+  _recordsUploaded = false;
+  delete _profiler;
+  _profiler = 0;
+  if (_storage) {
+    _storage->destroy();
+    delete _storage;
+    _storage = 0;
+  }
+  _vao.destroy();
+  //the names of the deleted objects may be reused
+  if (_state) {
+    _state->invalidate();
+    _state = 0;
+  }
+  _indexBuffer.clear();
+  _vertexBuffer.clear();
+  _mesh.clear();
+  _texture.clear();
+  _permutations.clear();
+  _programsReady = false;
+  _programsFailed = false;
+}
+
+void CubeRenderer::resize(int width, int height)
+{
+  int side = qMin(width, height);
+  _viewport = QRect((width - side) / 2, (height - side) / 2, side, side);
+  _scissor = QRect();
+  glViewport(_viewport.x(), _viewport.y(), _viewport.width(), _viewport.height());
+}
+
+void CubeRenderer::setTile(const QRect &tile)
+{
+  int side = qMin(tile.width(), tile.height());
+  _viewport = QRect(tile.x() + (tile.width() - side) / 2, tile.y() + (tile.height() - side) / 2, side, side);
+  _scissor = tile;
+}
+
+void CubeRenderer::render(const CubeState &state)
+{
+  //QOpenGLTexture binds the textures it uploads or evicts directly
+  const bool evicted = _textureLoader->use(_texture.data());
+  if (_textureLoader->upload(MaxTextureUploadsPerFrame) > 0 || evicted) {
+    _state->invalidate();
+  }
+
+  if (_profiler) {
+    _profiler->beginFrame();
+  }
+
+  //set every frame, a QPainter overlay on the same surface changes these
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_STENCIL_TEST);
+  glEnable(GL_CULL_FACE);
+  glViewport(_viewport.x(), _viewport.y(), _viewport.width(), _viewport.height());
+  if (_scissor.isNull()) {
+    glDisable(GL_SCISSOR_TEST);
+  }
+  else {
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(_scissor.x(), _scissor.y(), _scissor.width(), _scissor.height());
+  }
+
+  const QColor &clearColor = state.clearColor;
+  glClearColor(clearColor.red(), clearColor.green(), clearColor.blue(), clearColor.alpha());
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  if (_profiler) {
+    _profiler->mark(GpuProfiler::Clear);
+  }
+  //until the programs are linked the frame is just the clear in the state's color
+  if (!setUpPrograms(false)) {
+    if (_profiler) {
+      _profiler->mark(GpuProfiler::Upload);
+      _profiler->mark(GpuProfiler::Draw);
+    }
+    if (!_scissor.isNull()) {
+      glDisable(GL_SCISSOR_TEST);
+    }
+    if (_profiler) {
+      _profiler->endFrame();
+    }
+    ShaderCompiler::frameDrawn(false);
+    return;
+  }
+  //the program changes with the materials of the state
+  const QHash<Material::Set, Permutation>::const_iterator current = _permutations.constFind(permutation(state));
+  Q_ASSERT(current != _permutations.constEnd());
+  _state->useProgram(current->program->programId());
+  _storage->setProgram(current->program.data());
+  _state->bindVertexArray(_vao.objectId());
+
+  const qint64 uploadedBytes = _storage->uploadedBytes();
+  QElapsedTimer uploadTimer;
+  //only slots whose records changed since they were uploaded are sent
+  if (_instanceCount == 1) {
+    updateSingle(state);
+    uploadTimer.start();
+    _storage->uploadChanged(state.rotIndex, 1, _buffer.constData());
+  }
+  else if (!_recordsUploaded || !hasSameTransform(state, _uploadedState)) {
+    QElapsedTimer prepareTimer;
+    prepareTimer.start();
+    const GLfloat *records = _pipeline->acquire(state);
+    _prepareTime = prepareTimer.nsecsElapsed();
+    uploadTimer.start();
+    _storage->uploadChanged(0, _instanceCount, records);
+    _uploadedState = state;
+    _recordsUploaded = true;
+  }
+  else {
+    _prepareTime = 0;
+    uploadTimer.start();
+  }
+  _uploadTime = uploadTimer.nsecsElapsed();
+  if (_profiler) {
+    _profiler->mark(GpuProfiler::Upload);
+  }
+
+  //the shader indexes slot rotIndex + gl_InstanceID of the bound batch
+  const int batchCount = _storage->batchCount();
+  if (_instanceCount == 1) {
+    const int batch = state.rotIndex / _storage->batchSize();
+    _storage->bindBatch(batch);
+    glUniform1i(current->rotIndexLocation, state.rotIndex - batch * _storage->batchSize());
+  }
+  else {
+    glUniform1i(current->rotIndexLocation, 0);
+  }
+  _state->bindTexture(GL_TEXTURE0, _texture->target(), _texture->textureId());
+  //the index buffer is bound in the VAO
+  const GLsizei indexCount = _mesh->indexCount();
+  const GLenum indexType = _mesh->indexType();
+  if (_instanceCount == 1) {
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+  }
+  else {
+    for (int batch = 0; batch < batchCount; ++batch) {
+      const int instances = _storage->bindBatch(batch);
+      _f->glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, instances);
+    }
+  }
+  if (_profiler) {
+    _profiler->mark(GpuProfiler::Draw);
+  }
+  _storage->endFrame();
+  //some backends only send the parameters when a batch is bound
+  _uploadBytes = _storage->uploadedBytes() - uploadedBytes;
+  //keeps code drawing after this renderer, such as QPainter, from changing the VAO
+  _state->bindVertexArray(0);
+  if (!_scissor.isNull()) {
+    glDisable(GL_SCISSOR_TEST);
+  }
+
+  if (_profiler) {
+    _profiler->endFrame();
+  }
+  ShaderCompiler::frameDrawn(true);
+}
+
+void CubeRenderer::updateSingle(const CubeState &state)
+{
+  QMatrix4x4 m;
+  m.translate(0.0f, 0.0f, -10.0f);
+  m.rotate(state.xRot / 16.0f, 1.0f, 0.0f, 0.0f);
+  m.rotate(state.yRot / 16.0f, 0.0f, 1.0f, 0.0f);
+  m.rotate(state.zRot / 16.0f, 0.0f, 0.0f, 1.0f);
+
+  GLfloat *record = _buffer.data();
+  ParameterLayout::clear(record);
+  if (state.rotIndex == 0) {
+    ParameterLayout::setRotMatrix(record, m);
+  }
+  else {
+    QMatrix4x4 n = m;
+    n.scale(0.5, 0.5, 0.5);
+    ParameterLayout::setRotMatrix(record, n);
+  }
+  ParameterLayout::setMaterial(record, instanceMaterial(state.rotIndex));
+  ParameterLayout::setLayer(record, _layer);
+}
+
+void CubeRenderer::prepare(const CubeState &state)
+{
+  if (_pipeline) {
+    _pipeline->submit(state);
+  }
+}
+
+void CubeRenderer::prepareInstances(const CubeState &state, int first, int count, GLfloat *records) const
+{
+  //the padding stays zero, the pipeline's records are zero filled
+  const TransformBatch &transforms = _transforms[state.rotIndex == 0 ? 0 : 1];
+  transforms.compute(first, count, QVector3D(state.xRot / 16.0f, state.yRot / 16.0f, state.zRot / 16.0f),
+                     records + ParameterLayout::offset(ParameterLayout::RotMatrix), ParameterStorage::SlotFloats);
+  for (int i = first; i < first + count; ++i) {
+    ParameterLayout::setMaterial(records, instanceMaterial(i + state.rotIndex));
+    ParameterLayout::setLayer(records, (_layer + i) % _layerCount);
+    records += ParameterStorage::SlotFloats;
+  }
+}
+
+Material::Set CubeRenderer::materials(int rotIndex) const
+{
+  //instances alternate between two materials, the first two have both
+  Material::Set materials = 0;
+  for (int i = 0; i < qMin(_instanceCount, 2); ++i) {
+    materials |= Material::set(instanceMaterial(rotIndex + i));
+  }
+  return materials;
+}
+
+Material::Set CubeRenderer::permutation(const CubeState &state) const
+{
+  return Material::permutation(materials(state.rotIndex));
+}
+
+int CubeRenderer::selectedInstanceCount()
+{
+  return _selectedInstanceCount;
+}
+
+void CubeRenderer::setSelectedInstanceCount(int count)
+{
+  _selectedInstanceCount = qMax(1, count);
+}
+
+bool CubeRenderer::isTextureArrayEnabled()
+{
+  return _textureArrayEnabled;
+}
+
+void CubeRenderer::setTextureArrayEnabled(bool enabled)
+{
+  _textureArrayEnabled = enabled;
+}
+
+bool CubeRenderer::makeObject()
+{
+  SharedResources *resources = SharedResources::current();
+  if (_textureArrayEnabled) {
+    const QStringList paths = arrayImagePaths();
+    _texture = resources->textureArray(paths);
+    _layer = qMax(0, paths.indexOf(_texturePath));
+    _layerCount = paths.count();
+  }
+  else {
+    _texture = resources->texture(_texturePath);
+  }
+  _textureLoader = resources->textureLoader();
+  _memory = resources->memory();
+  _memory->addOwner(_texture.data(), _name);
+
+  _mesh = resources->mesh(Mesh::selectedPath());
+  if (!_mesh) {
+    return false;
+  }
+
+  //the buffers are only created by the first renderer of the share group
+  _vertexBuffer = resources->vertexBuffer(_mesh, _vertexFormat);
+  _indexBuffer = resources->indexBuffer(_mesh);
+  _memory->addOwner(_vertexBuffer.data(), _name);
+  _memory->addOwner(_indexBuffer.data(), _name);
+  _vertexBuffer->bind();
+  _indexBuffer->bind();
+  return true;
+}
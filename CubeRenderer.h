@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef CUBERENDERER_H
+#define CUBERENDERER_H
+
+#include <QHash>
+#include <QRect>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <QOpenGLFunctions>
+#include <QOpenGLVertexArrayObject>
+
+#include "CubeState.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "ParameterStorage.h"
+#include "TransformBatch.h"
+
+class FramePipeline;
+class GLStateCache;
+class GpuMemory;
+class GpuProfiler;
+class TextureLoader;
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLBuffer);
+QT_FORWARD_DECLARE_CLASS(QOpenGLExtraFunctions);
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram);
+QT_FORWARD_DECLARE_CLASS(QOpenGLTexture);
+
+// Draws the textured cube scene into whatever framebuffer is bound, independent of any widget.
+// All methods must be called with the same OpenGL context current. Bindings go through the
+// GLStateCache of that context, so renderers drawing one after another into the same surface only
+// issue the calls that change something.
+//
+// With an instance count of 1 a single cube is drawn from parameter slot rotIndex, as in the
+// original demo. With more instances a grid of cubes is drawn with glDrawElementsInstanced, each
+// instance reading its own parameter slot through gl_InstanceID; their matrices are computed
+// by a TransformBatch. The instance parameters are prepared on worker threads by a FramePipeline,
+// ahead of time for states passed to prepare(). Only records that changed since the last frame
+// are uploaded, so repainting an unchanged state sends nothing to the parameter storage.
+//
+// The geometry is the Mesh given by Mesh::selectedPath(), the cube by default, in the vertex
+// format given by Mesh::selectedVertexFormat(). It is drawn with one indexed draw call per frame
+// (per batch with instancing), its vertex and index buffers are shared like the program.
+//
+// The single cube's material follows rotIndex, instances alternate between two. A renderer
+// compiles the Material permutation of the materials it draws for either rotIndex: the single
+// cube gets a program per material with no material branch, the instanced grid the uber shader.
+//
+// With the texture array enabled every renderer samples the same GL_TEXTURE_2D_ARRAY holding all
+// cube images. The layer is a per-instance parameter next to the material id, so one instanced
+// draw can show differently textured cubes and all tiles bind the same texture.
+//
+// The GL objects a renderer draws with are owned by its name() in the GpuMemory of the share
+// group, so their memory can be reported per widget or tile.
+class CubeRenderer : protected QOpenGLFunctions
+{
+public:
+  CubeRenderer(const QString &texturePath, ParameterStorage::Backend backend, int instanceCount = 1,
+               ParameterEncoding::Encoding encoding = ParameterEncoding::selectedEncoding());
+  ~CubeRenderer();
+
+  // the owner of the renderer's GL objects in the GpuMemory, the texture path by default; set
+  // before initialize()
+  QString name() const { return _name; }
+  void setName(const QString &name) { _name = name; }
+
+  // false if the renderer cannot draw; its programs may still be compiling afterwards, render()
+  // only clears until they are ready
+  bool initialize();
+  void destroy();
+  // true once the programs are linked and set up
+  bool isReady() const { return _programsReady; }
+  // true if a program failed to build after initialize(), the renderer only clears; the log is printed
+  bool hasFailed() const { return _programsFailed; }
+  // blocks until the programs are linked and set up, for measurements that need every frame drawn
+  void waitForPrograms();
+  // draws into the whole framebuffer
+  void resize(int width, int height);
+  // draws into one tile of a shared framebuffer, in GL window coordinates; the clear is scissored to the tile
+  void setTile(const QRect &tile);
+  void render(const CubeState &state);
+  // starts preparing the parameters of a state that is about to be rendered, needs no context
+  void prepare(const CubeState &state);
+  // the material permutation render() draws a state with; renderers drawing into one surface are
+  // best sorted by it, so that they switch programs least often
+  Material::Set permutation(const CubeState &state) const;
+
+  ParameterStorage *storage() const { return _storage; }
+  // null until initialized
+  const Mesh *mesh() const { return _mesh.data(); }
+  Mesh::VertexFormat vertexFormat() const { return _vertexFormat; }
+  int instanceCount() const { return _instanceCount; }
+  // CPU time the last render() waited for the instance parameters, in nanoseconds
+  qint64 lastPrepareTime() const { return _prepareTime; }
+  // CPU time spent in the parameter upload of the last render(), in nanoseconds
+  qint64 lastUploadTime() const { return _uploadTime; }
+  // bytes of encoded parameters the last render() sent to the GL
+  qint64 lastUploadBytes() const { return _uploadBytes; }
+  // GPU stage timings, null unless GpuProfiler::isEnabled() and timer queries are available
+  GpuProfiler *profiler() const { return _profiler; }
+  // null with a single instance
+  const FramePipeline *pipeline() const { return _pipeline; }
+
+  static int selectedInstanceCount();
+  static void setSelectedInstanceCount(int count);
+  static bool isTextureArrayEnabled();
+  static void setTextureArrayEnabled(bool enabled);
+
+private:
+  struct Permutation
+  {
+    QSharedPointer<QOpenGLShaderProgram> program;
+    GLint rotIndexLocation;
+  };
+
+  bool makeObject();
+  // sets up the programs and the storage once every permutation is linked; with wait it blocks until
+  // then. False while they are compiling or if they failed
+  bool setUpPrograms(bool wait);
+  // the materials of the records drawn for rotIndex
+  Material::Set materials(int rotIndex) const;
+  void updateSingle(const CubeState &state);
+  // the records of instances [first, first + count), called on the pipeline's worker threads
+  void prepareInstances(const CubeState &state, int first, int count, GLfloat *records) const;
+
+  ParameterStorage::Backend _backend;
+  ParameterEncoding::Encoding _encoding;
+  Mesh::VertexFormat _vertexFormat;
+  QString _texturePath;
+  QString _name;
+  int _instanceCount;
+  QOpenGLExtraFunctions *_f;
+  GLStateCache *_state;
+
+  //shared with every renderer in the share group
+  //the programs of the material permutations, by Material::permutation()
+  QHash<Material::Set, Permutation> _permutations;
+  QSharedPointer<QOpenGLTexture> _texture;
+  QSharedPointer<const Mesh> _mesh;
+  QSharedPointer<QOpenGLBuffer> _vertexBuffer;
+  QSharedPointer<QOpenGLBuffer> _indexBuffer;
+  TextureLoader *_textureLoader;
+  GpuMemory *_memory;
+
+  //VAOs and parameter storage are per renderer
+  QOpenGLVertexArrayObject _vao;
+  ParameterStorage *_storage;
+  GpuProfiler *_profiler;
+  int _layer;
+  int _layerCount;
+  QRect _viewport;
+  QRect _scissor;
+  QVector<GLfloat> _buffer;
+  //the instance layouts of rotIndex 0 and 1, read by the worker threads
+  TransformBatch _transforms[2];
+  FramePipeline *_pipeline;
+  bool _programsReady;
+  bool _programsFailed;
+  //the state whose instance records the storage holds
+  CubeState _uploadedState;
+  bool _recordsUploaded;
+  qint64 _prepareTime;
+  qint64 _uploadTime;
+  qint64 _uploadBytes;
+
+  static int _selectedInstanceCount;
+  static bool _textureArrayEnabled;
+};
+
+#endif
@@ -0,0 +1,254 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <string.h>
+
+#include "FrameCapture.h"
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+
+QString FrameCapture::_directory;
+
+class FrameCapture::WriteTask : public QRunnable
+{
+public:
+  WriteTask(FrameCapture *capture, const QImage &image, const QString &fileName)
+    : _capture(capture), _image(image), _fileName(fileName) {}
+
+  void run()
+  {
+    //GL rows start at the bottom
+    if (_image.mirrored().save(_fileName)) {
+      _capture->_written.ref();
+    }
+    else {
+      qWarning() << "Could not write captured frame" << _fileName;
+    }
+    _capture->_queued.deref();
+  }
+
+private:
+  FrameCapture *_capture;
+  QImage _image;
+  QString _fileName;
+};
+
+//shared by every capture, PNG compression is the bulk of the work
+static QThreadPool *writerPool()
+{
+  static QThreadPool pool;
+  return &pool;
+}
+
+FrameCapture::FrameCapture(const QString &prefix)
+  : _prefix(prefix),
+    _f(0),
+    _initialized(false),
+    _async(false),
+    _next(0),
+    _frame(0),
+    _queued(0),
+    _written(0)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+  //the tasks count into this object
+  writerPool()->waitForDone();
+}
+
+QString FrameCapture::directory()
+{
+  return _directory;
+}
+
+void FrameCapture::setDirectory(const QString &directory)
+{
+  _directory = directory;
+}
+
+void FrameCapture::initialize()
+{
+  _initialized = true;
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  _f = context->extraFunctions();
+  //pixel pack buffers and glMapBufferRange come with the sync objects in both GL and GLES
+  _async = context->isOpenGLES() ? context->format().majorVersion() >= 3
+                                 : context->format().version() >= qMakePair(3, 2)
+                                   || context->hasExtension(QByteArrayLiteral("GL_ARB_sync"));
+  if (!_async) {
+    qWarning("No sync objects, %s frames are captured synchronously", qPrintable(_prefix));
+    return;
+  }
+  for (int i = 0; i < RingSize; ++i) {
+    _f->glGenBuffers(1, &_ring[i].buffer);
+  }
+}
+
+void FrameCapture::capture(const QRect &rect)
+{
+  if (!_initialized) {
+    initialize();
+  }
+  const int frame = _frame++;
+  if (_queued.loadAcquire() >= MaxQueuedImages) {
+    ++_statistics.dropped;
+    return;
+  }
+
+  if (!_async) {
+    QImage image(rect.size(), QImage::Format_RGBA8888);
+    _f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    _f->glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+    ++_statistics.captured;
+    write(image, frame);
+    return;
+  }
+
+  collect(false);
+  if (_ring[_next].frame >= 0) {
+    ++_statistics.stalls;
+    collect(true);
+  }
+
+  Slot &slot = _ring[_next];
+  _next = (_next + 1) % RingSize;
+  slot.size = rect.size();
+  slot.frame = frame;
+  //the read returns at once, the copy into the buffer runs after the frame on the GPU
+  _f->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  _f->glBufferData(GL_PIXEL_PACK_BUFFER, rect.width() * rect.height() * 4, 0, GL_STREAM_READ);
+  _f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  _f->glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  _f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = _f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  ++_statistics.captured;
+}
+
+void FrameCapture::collect(bool wait)
+{
+  for (int i = 0; i < RingSize; ++i) {
+    Slot &slot = _ring[(_next + i) % RingSize];
+    if (slot.frame < 0) {
+      continue;
+    }
+    //flushed, so the fence of the last frame signals; mapping waits for a readback that timed out
+    const GLuint64 timeout = wait ? GLuint64(1000000000) : 0;
+    const GLenum status = _f->glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (status == GL_TIMEOUT_EXPIRED && !wait) {
+      return;
+    }
+    read(slot);
+    //only the oldest is waited for, the rest are read if they are done already
+    wait = false;
+  }
+}
+
+void FrameCapture::read(Slot &slot)
+{
+  const int bytes = slot.size.width() * slot.size.height() * 4;
+  QImage image(slot.size, QImage::Format_RGBA8888);
+  _f->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  const void *mapped = _f->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+  if (mapped) {
+    memcpy(image.bits(), mapped, bytes);
+    _f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  _f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  _f->glDeleteSync(slot.fence);
+  slot.fence = 0;
+  if (mapped) {
+    write(image, slot.frame);
+  }
+  slot.frame = -1;
+}
+
+void FrameCapture::write(const QImage &image, int frame)
+{
+  const QString fileName = QString("%1/%2-%3.png").arg(_directory, _prefix).arg(frame, 6, 10, QLatin1Char('0'));
+  _queued.ref();
+  writerPool()->start(new WriteTask(this, image, fileName));
+}
+
+void FrameCapture::finish()
+{
+  if (_initialized) {
+    //oldest first, so the frames are queued in order
+    for (int i = 0; i < RingSize; ++i) {
+      Slot &slot = _ring[(_next + i) % RingSize];
+      if (slot.frame >= 0) {
+        _f->glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+        read(slot);
+      }
+      if (slot.buffer) {
+        _f->glDeleteBuffers(1, &slot.buffer);
+        slot.buffer = 0;
+      }
+    }
+    _initialized = false;
+  }
+  writerPool()->waitForDone();
+
+  const Statistics statistics = this->statistics();
+  if (statistics.captured > 0 || statistics.dropped > 0) {
+    qDebug("Captured %d frames of %s to %s: %d written, %d stalls, %d dropped", statistics.captured, qPrintable(_prefix),
+           qPrintable(_directory), statistics.written, statistics.stalls, statistics.dropped);
+  }
+}
+
+FrameCapture::Statistics FrameCapture::statistics() const
+{
+  Statistics statistics = _statistics;
+  statistics.written = _written.loadAcquire();
+  return statistics;
+}
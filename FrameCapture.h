@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLExtraFunctions);
+
+// Records the frames of a surface to numbered PNG files, <directory>/<prefix>-<frame>.png, without
+// waiting for the GPU. capture() starts a glReadPixels into the next pixel buffer object of a ring
+// and fences it; a later capture() maps the buffers whose fence has signaled and hands the pixels
+// to a thread pool, which flips and writes them. The GL thread only waits when all RingSize
+// buffers are still in flight, counted as a stall. Frames are numbered by capture() call, and one
+// is dropped rather than read if MaxQueuedImages are still waiting to be written, so a slow disk
+// leaves gaps instead of holding up the frames or growing the memory without bound.
+//
+// Contexts without sync objects (GL 3.2, GLES 3.0 or GL_ARB_sync) read every frame synchronously.
+class FrameCapture
+{
+public:
+  struct Statistics
+  {
+    Statistics() : captured(0), written(0), stalls(0), dropped(0) {}
+
+    int captured;  // frames read back
+    int written;   // files written
+    int stalls;    // captures that waited for the oldest readback
+    int dropped;   // captures skipped because too many images were waiting to be written
+  };
+
+  explicit FrameCapture(const QString &prefix);
+  ~FrameCapture();
+
+  // needs the context current and the framebuffer to read bound; rect is in GL window coordinates
+  void capture(const QRect &rect);
+  // needs the context current: writes the frames in flight, deletes the buffers and waits until
+  // every file is written
+  void finish();
+
+  Statistics statistics() const;
+
+  // where frames are written, empty when capture is disabled
+  static QString directory();
+  static void setDirectory(const QString &directory);
+  static bool isEnabled() { return !_directory.isEmpty(); }
+
+private:
+  Q_DISABLE_COPY(FrameCapture)
+
+  enum { RingSize = 3, MaxQueuedImages = 32 };
+
+  class WriteTask;
+  friend class WriteTask;
+
+  struct Slot
+  {
+    Slot() : buffer(0), fence(0), frame(-1) {}
+
+    GLuint buffer;
+    GLsync fence;
+    QSize size;
+    int frame;  // -1 when the slot is free
+  };
+
+  void initialize();
+  // maps the slots whose readback has finished, oldest first; with wait, waits for the oldest one
+  void collect(bool wait);
+  void read(Slot &slot);
+  void write(const QImage &image, int frame);
+
+  QString _prefix;
+  QOpenGLExtraFunctions *_f;
+  bool _initialized;
+  bool _async;
+  Slot _ring[RingSize];
+  //the slot the next capture reads into, the oldest one in flight when they all are
+  int _next;
+  int _frame;
+  Statistics _statistics;
+  //updated by the writer threads
+  QAtomicInt _queued;
+  QAtomicInt _written;
+
+  static QString _directory;
+};
+
+#endif
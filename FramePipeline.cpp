@@ -0,0 +1,234 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include "FramePipeline.h"
+
+int FramePipeline::_threadCount = QThread::idealThreadCount();
+
+struct FramePipeline::Job
+{
+  CubeState state;
+  GLfloat *records;
+  int recordFloats;
+  int count;
+  int chunkCount;
+  const PrepareFunction *prepare;
+  QAtomicInt nextChunk;
+  QAtomicInt remaining;
+
+  // false once every chunk has been claimed; never touches the frame after that, so a worker that
+  // starts late does not need the pipeline any more
+  bool runChunk()
+  {
+    const int chunk = nextChunk.fetchAndAddRelaxed(1);
+    if (chunk >= chunkCount) {
+      return false;
+    }
+    const int first = chunk * ChunkSize;
+    (*prepare)(state, first, qMin(int(ChunkSize), count - first), records + first * recordFloats);
+    remaining.deref();
+    return true;
+  }
+
+  // no chunk is claimed after this; the ones that were not claimed yet count as done
+  void cancel()
+  {
+    const int claimed = qMin(nextChunk.fetchAndStoreRelaxed(chunkCount), chunkCount);
+    remaining.fetchAndAddOrdered(claimed - chunkCount);
+  }
+
+  bool isDone() const { return remaining.loadAcquire() == 0; }
+};
+
+class FramePipeline::Worker : public QRunnable
+{
+public:
+  explicit Worker(const QSharedPointer<Job> &job) : _job(job) {}
+
+  void run()
+  {
+    while (_job->runChunk()) {
+    }
+  }
+
+private:
+  QSharedPointer<Job> _job;
+};
+
+static QThreadPool *workerPool()
+{
+  static QThreadPool pool;
+  return &pool;
+}
+
+FramePipeline::FramePipeline(int recordCount, int recordFloats, const PrepareFunction &prepare)
+  : _recordCount(recordCount),
+    _recordFloats(recordFloats),
+    _prepare(prepare),
+    _head(0),
+    _tail(0),
+    _holding(false)
+{
+  //zero filled, so the padding of the records stays zero
+  for (int i = 0; i < RingSize; ++i) {
+    _ring[i].records.resize(recordCount * recordFloats);
+  }
+  _late.records.resize(recordCount * recordFloats);
+  workerPool()->setMaxThreadCount(qMax(1, _threadCount));
+}
+
+FramePipeline::~FramePipeline()
+{
+  for (int i = _tail.load(); i != _head.load(); ++i) {
+    if (_ring[i % RingSize].job) {
+      cancel(_ring[i % RingSize].job.data());
+    }
+  }
+}
+
+QSharedPointer<FramePipeline::Job> FramePipeline::start(const CubeState &state, GLfloat *records, int helpers)
+{
+  QSharedPointer<Job> job(new Job);
+  job->state = state;
+  job->records = records;
+  job->recordFloats = _recordFloats;
+  job->count = _recordCount;
+  job->chunkCount = (_recordCount + ChunkSize - 1) / ChunkSize;
+  job->prepare = &_prepare;
+  job->nextChunk.store(0);
+  job->remaining.store(job->chunkCount);
+
+  const int workers = qMin(helpers, job->chunkCount);
+  for (int i = 0; i < workers; ++i) {
+    workerPool()->start(new Worker(job));
+  }
+  return job;
+}
+
+bool FramePipeline::finish(Job *job)
+{
+  if (job->isDone()) {
+    return false;
+  }
+  while (job->runChunk()) {
+  }
+  //the last chunks are being run by workers, they take a fraction of a frame
+  while (!job->isDone()) {
+    QThread::yieldCurrentThread();
+  }
+  return true;
+}
+
+void FramePipeline::cancel(Job *job)
+{
+  job->cancel();
+  //only the chunks the workers are running are waited for
+  while (!job->isDone()) {
+    QThread::yieldCurrentThread();
+  }
+}
+
+bool FramePipeline::submit(const CubeState &state)
+{
+  const int head = _head.load();
+  if (_threadCount == 0 || head - _tail.loadAcquire() >= RingSize) {
+    return false;
+  }
+
+  //not visible to acquire() before the head moves past it
+  Frame &frame = _ring[head % RingSize];
+  frame.state = state;
+  frame.job = start(state, frame.records.data(), _threadCount);
+  _head.storeRelease(head + 1);
+  return true;
+}
+
+const GLfloat *FramePipeline::acquire(const CubeState &state)
+{
+  int tail = _tail.load();
+  if (_holding) {
+    ++tail;
+    _holding = false;
+  }
+
+  const int head = _head.loadAcquire();
+  for (; tail != head; ++tail) {
+    Frame &frame = _ring[tail % RingSize];
+    //the records only depend on the transform, the same rule CubeRenderer uploads by
+    if (!hasSameTransform(frame.state, state)) {
+      //a stale frame costs no more than the chunks already running
+      cancel(frame.job.data());
+      frame.job.clear();
+      ++_statistics.dropped;
+      continue;
+    }
+    const bool waited = finish(frame.job.data());
+    frame.job.clear();
+    _holding = true;
+    _tail.storeRelease(tail);
+    if (waited) {
+      ++_statistics.waited;
+    }
+    else {
+      ++_statistics.ready;
+    }
+    return frame.records.constData();
+  }
+  _tail.storeRelease(tail);
+
+  ++_statistics.missed;
+  QSharedPointer<Job> job = start(state, _late.records.data(), qMin(_threadCount, (_recordCount - 1) / ChunkSize));
+  finish(job.data());
+  return _late.records.constData();
+}
+
+int FramePipeline::threadCount()
+{
+  return _threadCount;
+}
+
+void FramePipeline::setThreadCount(int count)
+{
+  _threadCount = qMax(0, count);
+}
@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QVector>
+#include <qopengl.h>
+
+#include <functional>
+
+#include "CubeState.h"
+
+// Prepares the parameter records of upcoming frames on a thread pool while the GL thread uploads
+// and draws the current one. submit() queues the records of a state as soon as the state is known;
+// acquire() hands them to the GL thread when the frame is drawn, so only the upload stays serial.
+//
+// A frame is split into chunks of ChunkSize records. Pool workers, and the thread waiting in
+// acquire(), claim chunks from a shared atomic counter until none are left, so every core stays
+// busy however unevenly the chunks run. Frames are passed from the submitting thread to the
+// acquiring thread through atomic ring indexes, there is no lock on the frame path; one thread may
+// submit and one may acquire at a time.
+class FramePipeline
+{
+public:
+  // fills the records of instances [first, first + count), the record of first at records; runs on
+  // pool threads, several chunks of a frame at once
+  typedef std::function<void(const CubeState &state, int first, int count, GLfloat *records)> PrepareFunction;
+
+  struct Statistics
+  {
+    Statistics() : ready(0), waited(0), missed(0), dropped(0) {}
+
+    qint64 ready;    // acquired frames that were complete already
+    qint64 waited;   // acquired frames that were still being prepared
+    qint64 missed;   // acquired states that had not been submitted
+    qint64 dropped;  // submitted frames that were never acquired
+  };
+
+  FramePipeline(int recordCount, int recordFloats, const PrepareFunction &prepare);
+  // cancels the frames in flight, waiting only for the chunks being prepared
+  ~FramePipeline();
+
+  // starts preparing the records of state, false if RingSize - 1 frames are already waiting
+  bool submit(const CubeState &state);
+  // the records of state, valid until the next acquire(). Any submitted frame with the same
+  // transform serves, frames submitted before it are dropped; a state that was not submitted is
+  // prepared now.
+  const GLfloat *acquire(const CubeState &state);
+
+  const Statistics &statistics() const { return _statistics; }
+
+  // worker threads shared by all pipelines, 0 prepares every frame on the acquiring thread
+  static int threadCount();
+  static void setThreadCount(int count);
+
+private:
+  enum { RingSize = 3, ChunkSize = 256 };
+
+  struct Job;
+  class Worker;
+
+  struct Frame
+  {
+    CubeState state;
+    QVector<GLfloat> records;
+    QSharedPointer<Job> job;
+  };
+
+  QSharedPointer<Job> start(const CubeState &state, GLfloat *records, int helpers);
+  // runs chunks of the job until none are left, then waits for the workers to finish theirs;
+  // returns false if the job was complete already
+  static bool finish(Job *job);
+  // stops the job from starting chunks and waits for the ones workers are running
+  static void cancel(Job *job);
+
+  int _recordCount;
+  int _recordFloats;
+  PrepareFunction _prepare;
+  Frame _ring[RingSize];
+  //frames [tail, head) are submitted; tail is the frame held by the acquiring thread, if any
+  QAtomicInt _head;
+  QAtomicInt _tail;
+  bool _holding;
+  //for states that were not submitted
+  Frame _late;
+  Statistics _statistics;
+
+  static int _threadCount;
+};
+
+#endif
@@ -0,0 +1,287 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QDebug>
+
+#include <math.h>
+
+#include "FrameStatistics.h"
+
+Q_LOGGING_CATEGORY(lcFrameStatistics, "textures.frames", QtInfoMsg)
+
+static const char *metricNameTable[] = { "paint", "updateLatency", "frameInterval", "inputToGpu", "inputToSwap" };
+static const char *counterNameTable[] = { "frames", "ticks", "lateTicks", "droppedFrames", "fallbackTicks",
+                                           "throttleWaits" };
+
+//every FrameStatistics alive; the lock is only taken to add, remove or export one
+static QMutex registryMutex;
+static QList<FrameStatistics *> registry;
+
+void FrameHistogram::record(qint64 microseconds)
+{
+  _counts[bucket(microseconds)].fetchAndAddRelaxed(1);
+}
+
+QVector<int> FrameHistogram::counts() const
+{
+  QVector<int> counts(BucketCount);
+  for (int i = 0; i < BucketCount; ++i) {
+    counts[i] = _counts[i].load();
+  }
+  return counts;
+}
+
+FrameHistogram::Summary FrameHistogram::summarize(const QVector<int> &counts)
+{
+  Summary summary;
+  for (int i = 0; i < counts.count(); ++i) {
+    summary.count += counts[i];
+    if (counts[i] > 0) {
+      summary.max = bucketStart(i) + bucketWidth(i) - 1;
+    }
+  }
+  if (summary.count == 0) {
+    return summary;
+  }
+
+  //the smallest value with at least p of the counts at or below it
+  const double percentiles[3] = { 0.50, 0.95, 0.99 };
+  qint64 *values[3] = { &summary.p50, &summary.p95, &summary.p99 };
+  qint64 seen = 0;
+  int next = 0;
+  for (int i = 0; i < counts.count() && next < 3; ++i) {
+    seen += counts[i];
+    while (next < 3 && seen >= qint64(ceil(percentiles[next] * summary.count))) {
+      *values[next++] = bucketStart(i) + (bucketWidth(i) - 1) / 2;
+    }
+  }
+  return summary;
+}
+
+int FrameHistogram::bucket(qint64 microseconds)
+{
+  if (microseconds < ExactBuckets) {
+    return int(qMax(Q_INT64_C(0), microseconds));
+  }
+  //the top log2(SubBuckets) + 1 bits select the bucket
+  const int shift = 63 - qCountLeadingZeroBits(quint64(microseconds)) - 4;
+  return qMin(int(SubBuckets * shift + (microseconds >> shift)), int(BucketCount) - 1);
+}
+
+qint64 FrameHistogram::bucketStart(int bucket)
+{
+  if (bucket < ExactBuckets) {
+    return bucket;
+  }
+  const int shift = bucket / SubBuckets - 1;
+  return qint64(bucket % SubBuckets + SubBuckets) << shift;
+}
+
+qint64 FrameHistogram::bucketWidth(int bucket)
+{
+  return bucket < ExactBuckets ? 1 : Q_INT64_C(1) << (bucket / SubBuckets - 1);
+}
+
+FrameStatistics::FrameStatistics(const QString &source)
+  : _source(source)
+{
+  for (int i = 0; i < CounterCount; ++i) {
+    _reportedCounters[i] = 0;
+  }
+  QMutexLocker locker(&registryMutex);
+  registry.append(this);
+}
+
+FrameStatistics::~FrameStatistics()
+{
+  QMutexLocker locker(&registryMutex);
+  registry.removeOne(this);
+}
+
+void FrameStatistics::record(Metric metric, qint64 nsecs)
+{
+  _histograms[metric].record(nsecs / 1000);
+}
+
+void FrameStatistics::add(Counter counter, int count)
+{
+  _counters[counter].fetchAndAddRelaxed(count);
+}
+
+void FrameStatistics::updateRequested()
+{
+  //the latency is that of the oldest request, later ones are painted by the same frame
+  if (!_updateTimer.isValid()) {
+    _updateTimer.start();
+  }
+}
+
+void FrameStatistics::beginPaint()
+{
+  _paintTimer.start();
+  if (_updateTimer.isValid()) {
+    record(UpdateLatency, _updateTimer.nsecsElapsed());
+    _updateTimer.invalidate();
+  }
+}
+
+void FrameStatistics::endPaint()
+{
+  record(PaintTime, _paintTimer.nsecsElapsed());
+  add(Frames);
+}
+
+FrameHistogram::Summary FrameStatistics::summary(Metric metric) const
+{
+  return FrameHistogram::summarize(_histograms[metric].counts());
+}
+
+int FrameStatistics::counter(Counter counter) const
+{
+  return _counters[counter].load();
+}
+
+QString FrameStatistics::metricName(Metric metric)
+{
+  return QString::fromLatin1(metricNameTable[metric]);
+}
+
+QString FrameStatistics::counterName(Counter counter)
+{
+  return QString::fromLatin1(counterNameTable[counter]);
+}
+
+QByteArray FrameStatistics::csv()
+{
+  //counters go in the count column
+  QString csv = QStringLiteral("source,metric,count,p50_us,p95_us,p99_us,max_us\n");
+  QMutexLocker locker(&registryMutex);
+  foreach (const FrameStatistics *statistics, registry) {
+    for (int i = 0; i < MetricCount; ++i) {
+      const FrameHistogram::Summary summary = statistics->summary(static_cast<Metric>(i));
+      if (summary.count > 0) {
+        csv += QString("%1,%2,%3,%4,%5,%6,%7\n").arg(statistics->source(), metricName(static_cast<Metric>(i)))
+            .arg(summary.count).arg(summary.p50).arg(summary.p95).arg(summary.p99).arg(summary.max);
+      }
+    }
+    for (int i = 0; i < CounterCount; ++i) {
+      const int value = statistics->counter(static_cast<Counter>(i));
+      if (value != 0) {
+        csv += QString("%1,%2,%3,,,,\n").arg(statistics->source(), counterName(static_cast<Counter>(i))).arg(value);
+      }
+    }
+  }
+  return csv.toUtf8();
+}
+
+bool FrameStatistics::writeCsv(const QString &path)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(csv()) < 0) {
+    qWarning() << "Cannot write frame statistics to" << path << ":" << file.errorString();
+    return false;
+  }
+  return true;
+}
+
+QString FrameStatistics::reportLine()
+{
+  QString line = _source + ':';
+  bool empty = true;
+  for (int i = 0; i < MetricCount; ++i) {
+    const QVector<int> counts = _histograms[i].counts();
+    QVector<int> recent = counts;
+    if (_reportedCounts[i].count() == counts.count()) {
+      for (int j = 0; j < counts.count(); ++j) {
+        recent[j] -= _reportedCounts[i][j];
+      }
+    }
+    _reportedCounts[i] = counts;
+
+    const FrameHistogram::Summary summary = FrameHistogram::summarize(recent);
+    if (summary.count > 0) {
+      line += QString(" %1 p50 %2 p95 %3 p99 %4 max %5us")
+          .arg(metricName(static_cast<Metric>(i))).arg(summary.p50).arg(summary.p95).arg(summary.p99).arg(summary.max);
+      empty = false;
+    }
+  }
+  for (int i = 0; i < CounterCount; ++i) {
+    const int value = counter(static_cast<Counter>(i));
+    if (value != _reportedCounters[i]) {
+      line += QString(" %1 %2").arg(counterName(static_cast<Counter>(i))).arg(value - _reportedCounters[i]);
+      _reportedCounters[i] = value;
+      empty = false;
+    }
+  }
+  return empty ? QString() : line;
+}
+
+void FrameStatistics::startReporting(const QString &csvPath, int interval)
+{
+  QCoreApplication *app = QCoreApplication::instance();
+  QTimer *timer = new QTimer(app);
+  QObject::connect(timer, &QTimer::timeout, timer, [] {
+    if (!lcFrameStatistics().isDebugEnabled()) {
+      return;
+    }
+    QMutexLocker locker(&registryMutex);
+    foreach (FrameStatistics *statistics, registry) {
+      const QString line = statistics->reportLine();
+      if (!line.isEmpty()) {
+        qCDebug(lcFrameStatistics) << qPrintable(line);
+      }
+    }
+  });
+  timer->start(interval);
+
+  //the surfaces, and their statistics, still exist when the event loop quits
+  if (!csvPath.isEmpty()) {
+    QObject::connect(app, &QCoreApplication::aboutToQuit, app, [csvPath] {
+      writeCsv(csvPath);
+    });
+  }
+}
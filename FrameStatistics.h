@@ -0,0 +1,163 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef FRAMESTATISTICS_H
+#define FRAMESTATISTICS_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QString>
+#include <QVector>
+
+Q_DECLARE_LOGGING_CATEGORY(lcFrameStatistics)
+
+// Histogram of durations in microseconds with a fixed set of buckets: exact below ExactBuckets,
+// then SubBuckets per power of two, so every bucket is within 1/SubBuckets of its value. Values
+// are counted with one atomic increment and no lock, so any thread can record while another one
+// reads; readers take a snapshot of the counts.
+class FrameHistogram
+{
+public:
+  enum {
+    SubBuckets = 16,
+    ExactBuckets = 2 * SubBuckets,
+    // up to 2^26 us, about a minute; longer values land in the last bucket
+    BucketCount = SubBuckets * 22 + ExactBuckets - SubBuckets
+  };
+
+  struct Summary
+  {
+    Summary() : count(0), p50(0), p95(0), p99(0), max(0) {}
+
+    qint64 count;
+    // microseconds, the middle of the bucket holding the percentile; max is the top of the last bucket
+    qint64 p50;
+    qint64 p95;
+    qint64 p99;
+    qint64 max;
+  };
+
+  void record(qint64 microseconds);
+  QVector<int> counts() const;
+
+  static Summary summarize(const QVector<int> &counts);
+  static int bucket(qint64 microseconds);
+  static qint64 bucketStart(int bucket);
+  static qint64 bucketWidth(int bucket);
+
+private:
+  QAtomicInt _counts[BucketCount];
+};
+
+// Frame timings of one surface or animation, kept in FrameHistograms and counters that can be
+// recorded from the thread that paints while they are exported from another one. Every instance
+// is listed by all(); startReporting() logs them periodically to the textures.frames category
+// and writes them as CSV on exit.
+//
+// updateRequested(), beginPaint() and endPaint() keep the time of the pending update and of the
+// paint in progress, so they must all be called from the painting thread.
+class FrameStatistics
+{
+public:
+  enum Metric {
+    PaintTime,      // CPU time of paintGL()
+    UpdateLatency,  // from the first update() after a paint to the start of the next paint
+    FrameInterval,  // between animation ticks
+    InputToGpu,     // from an input event to the GPU finishing the frame that shows it
+    InputToSwap,    // from an input event to the surface presenting the frame that shows it
+    MetricCount
+  };
+
+  enum Counter {
+    Frames,         // paints
+    Ticks,          // animation ticks on a presented frame
+    LateTicks,      // ticks more than half a refresh interval late
+    DroppedFrames,  // refresh intervals missed by the late ticks
+    FallbackTicks,  // ticks of the fallback timer, when no frame was presented
+    ThrottleWaits,  // paints that waited for the GPU in low latency mode
+    CounterCount
+  };
+
+  explicit FrameStatistics(const QString &source);
+  ~FrameStatistics();
+
+  QString source() const { return _source; }
+
+  // lock-free, from any thread
+  void record(Metric metric, qint64 nsecs);
+  void add(Counter counter, int count = 1);
+
+  void updateRequested();
+  void beginPaint();
+  void endPaint();
+
+  FrameHistogram::Summary summary(Metric metric) const;
+  int counter(Counter counter) const;
+
+  static QString metricName(Metric metric);
+  static QString counterName(Counter counter);
+
+  // one line per metric and counter of every instance alive
+  static QByteArray csv();
+  static bool writeCsv(const QString &path);
+  // logs every interval milliseconds what was recorded since the last log, if textures.frames
+  // debug output is enabled, and writes csvPath, unless empty, when the application quits
+  static void startReporting(const QString &csvPath, int interval = 5000);
+
+private:
+  Q_DISABLE_COPY(FrameStatistics)
+
+  // the log line of what was recorded since the previous one, called by the reporting timer
+  QString reportLine();
+
+  QString _source;
+  FrameHistogram _histograms[MetricCount];
+  QAtomicInt _counters[CounterCount];
+  //painting thread only
+  QElapsedTimer _updateTimer;
+  QElapsedTimer _paintTimer;
+  //reporting thread only, the counts of the previous log line
+  QVector<int> _reportedCounts[MetricCount];
+  int _reportedCounters[CounterCount];
+};
+
+#endif
@@ -0,0 +1,158 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include "GLStateCache.h"
+
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+
+GLStateCache::GLStateCache(QObject *parent)
+  : QObject(parent),
+    _f(QOpenGLContext::currentContext()->extraFunctions())
+{
+  invalidate();
+}
+
+GLStateCache *GLStateCache::current()
+{
+  //bindings are per context, unlike the objects in SharedResources
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  GLStateCache *cache = context->findChild<GLStateCache *>(QString(), Qt::FindDirectChildrenOnly);
+  if (!cache) {
+    cache = new GLStateCache(context);
+  }
+  return cache;
+}
+
+void GLStateCache::invalidate()
+{
+  _program = InvalidName;
+  _vertexArray = InvalidName;
+  _activeUnit = InvalidUnit;
+  _textures.clear();
+  _buffers.clear();
+  _ranges.clear();
+}
+
+template <typename T> bool GLStateCache::change(T &tracked, const T &value)
+{
+  if (tracked == value) {
+    ++_statistics.skipped;
+    return false;
+  }
+  tracked = value;
+  ++_statistics.issued;
+  return true;
+}
+
+template <typename Key, typename T> bool GLStateCache::change(QHash<Key, T> &tracked, const Key &key, const T &value)
+{
+  typename QHash<Key, T>::iterator it = tracked.find(key);
+  if (it != tracked.end() && *it == value) {
+    ++_statistics.skipped;
+    return false;
+  }
+  tracked.insert(key, value);
+  ++_statistics.issued;
+  return true;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+  if (change(_program, program)) {
+    _f->glUseProgram(program);
+  }
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+  if (change(_vertexArray, vertexArray)) {
+    _f->glBindVertexArray(vertexArray);
+    //the element array binding is part of the vertex array
+    _buffers.remove(GL_ELEMENT_ARRAY_BUFFER);
+  }
+}
+
+void GLStateCache::activeTexture(GLenum unit)
+{
+  if (change(_activeUnit, unit)) {
+    _f->glActiveTexture(unit);
+  }
+}
+
+void GLStateCache::bindTexture(GLenum unit, GLenum target, GLuint texture)
+{
+  const QPair<GLenum, GLenum> key(unit, target);
+  if (_textures.value(key, InvalidName) == texture) {
+    ++_statistics.skipped;
+    return;
+  }
+  activeTexture(unit);
+  change(_textures, key, texture);
+  _f->glBindTexture(target, texture);
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+  if (change(_buffers, target, buffer)) {
+    _f->glBindBuffer(target, buffer);
+  }
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+  if (change(_ranges, qMakePair(target, index), BufferRange(buffer))) {
+    _f->glBindBufferBase(target, index, buffer);
+    //binds the generic binding point as well
+    _buffers.insert(target, buffer);
+  }
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+  if (change(_ranges, qMakePair(target, index), BufferRange(buffer, offset, size))) {
+    _f->glBindBufferRange(target, index, buffer, offset, size);
+    _buffers.insert(target, buffer);
+  }
+}
@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLExtraFunctions);
+
+// Shadow of the bindings of one context: program, vertex array, active texture unit, the texture
+// of every unit, buffers per target and indexed uniform/storage buffer ranges. A call that would
+// not change the tracked value is dropped; statistics() counts the calls issued and skipped.
+// Uniform values are not tracked: they belong to the shared programs, which any context of the
+// group may change behind this one's back.
+//
+// Only calls made through the cache are tracked. Code that changes the same state directly, such
+// as QPainter, QOpenGLTexture::bind() or the texture loader, must be followed by invalidate();
+// owners of a surface invalidate at the start of every frame.
+class GLStateCache : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Statistics
+  {
+    Statistics() : issued(0), skipped(0) {}
+
+    qint64 issued;   // state calls passed on to the GL
+    qint64 skipped;  // state calls that would have set the value already set
+  };
+
+  // the cache of the current context, created on first use
+  static GLStateCache *current();
+
+  // forget every tracked value, the next call of each kind is issued
+  void invalidate();
+
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vertexArray);
+  void activeTexture(GLenum unit);
+  // binds texture on unit, making it the active unit if it is not bound there yet
+  void bindTexture(GLenum unit, GLenum target, GLuint texture);
+  void bindBuffer(GLenum target, GLuint buffer);
+  void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+  void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+  const Statistics &statistics() const { return _statistics; }
+
+private:
+  enum { InvalidName = ~0u, InvalidUnit = 0 };
+
+  explicit GLStateCache(QObject *parent);
+
+  // true, and counted as issued, if value differs from the tracked one, which then takes it
+  template <typename T> bool change(T &tracked, const T &value);
+  // as above for a keyed binding, which is unknown until it has been set once
+  template <typename Key, typename T> bool change(QHash<Key, T> &tracked, const Key &key, const T &value);
+
+  struct BufferRange
+  {
+    BufferRange(GLuint buffer = 0, GLintptr offset = 0, GLsizeiptr size = 0) : buffer(buffer), offset(offset), size(size) {}
+
+    bool operator==(const BufferRange &other) const
+    {
+      return buffer == other.buffer && offset == other.offset && size == other.size;
+    }
+
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;  // 0 for the whole buffer, as with glBindBufferBase
+  };
+
+  QOpenGLExtraFunctions *_f;
+  //InvalidName and InvalidUnit while unknown
+  GLuint _program;
+  GLuint _vertexArray;
+  GLenum _activeUnit;
+  QHash<QPair<GLenum, GLenum>, GLuint> _textures;
+  QHash<GLenum, GLuint> _buffers;
+  QHash<QPair<GLenum, GLuint>, BufferRange> _ranges;
+  Statistics _statistics;
+};
+
+#endif
@@ -39,10 +39,16 @@
 ****************************************************************************/
 
 #include <QtWidgets>
-#include <QtOpenGL>
-#include <QOpenGLContext>
 
+#include "CubeRenderer.h"
+#include "FrameCapture.h"
+#include "GLStateCache.h"
 #include "GLWidget.h"
+#include "GpuProfiler.h"
+#include "InputLatency.h"
+#include "ShaderCompiler.h"
+#include "SharedResources.h"
+#include "TextureLoader.h"
 
 GLWidget::GLWidget(const QString& texturePath, QWidget *parent)
   : QOpenGLWidget(parent),
@@ -51,26 +57,27 @@ GLWidget::GLWidget(const QString& texturePath, QWidget *parent)
     _yRot(0),
     _zRot(0),
     _rotIndex(0),
-    _program(0),
+    _pendingXRot(0),
+    _pendingYRot(0),
+    _pendingZRot(0),
+    _painted(false),
     _texturePath(texturePath),
-#ifdef USE_UBO
-    _uboId(0),
-    _uboIndex(0),
-#else
-    _floatStorageTexId(0),
-    _intStorageTexId(0),
-#endif
-    _vboId(0),
-    _f(0)
+    _renderer(0),
+    _capture(0),
+    _statistics(QStringLiteral("widget ") + QFileInfo(texturePath).baseName())
 {
+  _latency = new InputLatency(this, &_statistics);
 }
 
 GLWidget::~GLWidget()
 {
   makeCurrent();
-  _vao.destroy();
-  delete _texture;
-  delete _program;
+  _latency->destroy();
+  if (_capture) {
+    _capture->finish();
+    delete _capture;
+  }
+  delete _renderer;
   doneCurrent();
 }
 
@@ -86,298 +93,127 @@ QSize GLWidget::sizeHint() const
 
 void GLWidget::rotateBy(int xAngle, int yAngle, int zAngle)
 {
+  if (xAngle == 0 && yAngle == 0 && zAngle == 0) {
+    return;
+  }
   _xRot += xAngle;
   _yRot += yAngle;
   _zRot += zAngle;
-  update();
+  //the instance parameters are prepared on the worker threads until the widget is painted
+  if (_renderer) {
+    _renderer->prepare(state());
+  }
+  updateState();
 }
 
 void GLWidget::setClearColor(const QColor &color)
 {
+  if (_clearColor == color) {
+    return;
+  }
   _clearColor = color;
-  update();
+  updateState();
 }
 
-void GLWidget::initializeGL()
+void GLWidget::updateState()
 {
-  initializeOpenGLFunctions();
-  _f = QOpenGLContext::currentContext()->extraFunctions();
-
-  //create VAO
-  _vao.create();
-  _vao.bind();
-
-  makeObject();
-
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_STENCIL_TEST);
-  glEnable(GL_CULL_FACE);
-  glEnable(GL_TEXTURE_2D);
-  glViewport(0, 0, width(), height());
-
-#define PROGRAM_VERTEX_ATTRIBUTE 0
-#define PROGRAM_TEXCOORD_ATTRIBUTE 1
-
-
-#ifdef USE_UBO
-  QOpenGLShader *vshader = new QOpenGLShader(QOpenGLShader::Vertex, this);
-  QString vsrc =
-      "in vec4 vertex;\n"
-      "in vec2 texCoord;\n"
-      "out vec2 texc;\n"
-      "flat out int materialID;"
-      "uniform int rotIndex;\n"
-      "\n"
-      "int getRotoationIndex(void);\n"
-      "mat4 getRotationMatrix(int Index);\n"
-      "mat4 getRotationMatrix(void);\n"
-      "\n"
-      "int getMaterialId(int Index);\n"
-      "int getMaterialId(void);\n"
-      "\n"
-      "struct VertexData {\n"
-      "  mat4 rotMatrix;\n"
-      "  int material;\n" //the iMX6 needs at least two elements in a struct, otherwise graphical corruption
-      "  int dummy1;\n"
-      "  int dummy2;\n"
-      "  int dummy3;\n"
-      "};\n"
-      "layout(std140) uniform u_VertexData {\n"
-      "  VertexData vData[2];\n"
-      "};\n"
-      "\n"
-      "int getRotationIndex(void)        { return rotIndex; }\n"
-      "mat4 getRotationMatrix(int Index) { return vData[Index].rotMatrix; }\n"
-      "mat4 getRotationMatrix(void)      { return getRotationMatrix(getRotationIndex()); }\n"
-      "\n"
-      "int getMaterialId(int Index)      { return vData[Index].material; }\n"
-      "int getMaterialId(void)           { return getMaterialId(getRotationIndex()); }\n"
-      "\n"
-      "void main(void)\n"
-      "{\n"
-      "    mat4 rotMatrix = getRotationMatrix();\n"
-      "    gl_Position = rotMatrix * vertex;\n"
-      "    materialID = getMaterialId();\n"
-      "    texc = texCoord;\n"
-      "}\n";
-#else
-  QOpenGLShader *vshader = new QOpenGLShader(QOpenGLShader::Vertex, this);
-  QString vsrc =
-      "#ifdef GL_ES\n"
-      "precision mediump float;\n"
-      "precision mediump sampler2D;\n"
-      "precision mediump isampler2D;\n"
-      "#endif\n"
-      "in vec4 vertex;\n"
-      "in vec2 texCoord;\n"
-      "flat out int materialID;\n"
-      "out vec2 texc;\n"
-      "uniform int rotIndex;\n"
-      "uniform sampler2D floatSampler;\n"
-      "uniform isampler2D intSampler;\n"
-      "\n"
-      "int getRotoationIndex(void);\n"
-      "mat4 getRotationMatrix(int Index);\n"
-      "mat4 getRotationMatrix(void);\n"
-      "\n"
-      "int getMaterialId(int Index);\n"
-      "int getMaterialId(void);\n"
-      "\n"
-      "int getRotationIndex(void)        { return rotIndex; }\n"
-      "mat4 getRotationMatrix(void)      { return getRotationMatrix(getRotationIndex()); }\n"
-      "mat4 getRotationMatrix(int index) { return mat4(texelFetch(floatSampler, ivec2(0+5*index,0), 0), texelFetch(floatSampler, ivec2(1+5*index,0), 0), texelFetch(floatSampler, ivec2(2+5*index,0), 0), texelFetch(floatSampler, ivec2(3+5*index,0), 0)); }\n"
-      "\n"
-      "int getMaterialId(int index)      { return int(texelFetch(intSampler, ivec2(4+5*index,0), 0).r); }\n"
-      "int getMaterialId(void)           { return getMaterialId(getRotationIndex()); }\n"
-      "\n"
-      "void main(void)\n"
-      "{\n"
-      "    mat4 rotMatrix = getRotationMatrix(rotIndex);\n"
-      "    gl_Position = rotMatrix * vertex;\n"
-      "    materialID = getMaterialId();\n"
-      "    texc = texCoord;\n"
-      "}\n";
-#endif
-
-  QOpenGLShader *fshader = new QOpenGLShader(QOpenGLShader::Fragment, this);
-  QString fsrc =
-      "#ifdef GL_ES\n"
-      "precision mediump float;\n"
-      "precision mediump sampler2D;\n"
-      "precision mediump isampler2D;\n"
-      "#endif\n"
-      "in vec2 texc;\n"
-      "flat in int materialID;"
-      "out vec4 fragColor;\n"
-      "uniform sampler2D tex;\n"
-      "void main(void)\n"
-      "{\n"
-      "  if (materialID == 1) {\n"
-      "    fragColor = mix(texture(tex, texc), vec4(1.0, 0.0, 0.0, 0.5), 0.4);\n"
-      "  }\n"
-      "  if (materialID == 7) {\n"
-      "    fragColor = mix(texture(tex, texc), vec4(0.0, 0.0, 1.0, 0.5), 0.4);\n"
-      "  }\n"
-      "}\n";
-
-
-  if (QOpenGLContext::currentContext()->isOpenGLES()) {
-    vsrc.prepend(QByteArrayLiteral("#version 300 es\n"));
-    fsrc.prepend(QByteArrayLiteral("#version 300 es\n"));
+  if (!_painted || state() != _paintedState) {
+    _statistics.updateRequested();
+    update();
   }
-  else {
-    vsrc.prepend(QByteArrayLiteral("#version 150\n"));
-    fsrc.prepend(QByteArrayLiteral("#version 150\n"));
-
-  }
-  vshader->compileSourceCode(vsrc);
-  fshader->compileSourceCode(fsrc);
-
-  _program = new QOpenGLShaderProgram(this);
-  if (!_program->addShader(vshader)) {
-    qDebug("Could not add vertex shader. Error log is:");
-    qWarning() << _program->log();
-    exit(EXIT_FAILURE);
-  }
-  if (!_program->addShader(fshader)) {
-    qDebug("Could not add fragment shader. Error log is:");
-    qWarning() << _program->log();
-    exit(EXIT_FAILURE);
-  }
-  _program->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-  _program->bindAttributeLocation("texCoord", PROGRAM_TEXCOORD_ATTRIBUTE);
-  if (!_program->link()) {
-     qDebug("Could not link shader program. Error log is:");
-    qWarning() << _program->log();
-    exit(EXIT_FAILURE);
-  }
-
-  _program->bind();
-  _program->setUniformValue("tex", 0);
+}
 
- #ifdef USE_UBO
-  qDebug("UBO-based shader parameter mechanism");
-  //use UBO as a shader parameter mechanism
-  glGenBuffers(1, &_uboId);
-  _uboIndex = _f->glGetUniformBlockIndex(_program->programId(), "u_VertexData");
-  if (_uboIndex == GL_INVALID_INDEX) {
-    qWarning("u_VertexData uniform block index could not be determined.");
+void GLWidget::initializeGL()
+{
+  _renderer = new CubeRenderer(_texturePath, ParameterStorage::selectedBackend(), CubeRenderer::selectedInstanceCount());
+  _renderer->setName(_statistics.source());
+  if (!_renderer->initialize()) {
     exit(EXIT_FAILURE);
   }
-  else {
-    _f->glGetActiveUniformBlockiv(_program->programId(), _uboIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &_uboSize);
+  _renderer->resize(width(), height());
+  if (FrameCapture::isEnabled()) {
+    _capture = new FrameCapture(QStringLiteral("widget-") + QFileInfo(_texturePath).baseName());
   }
 
-  //create UBO data store
-  glBindBuffer(GL_UNIFORM_BUFFER, _uboId);
-  glBufferData(GL_UNIFORM_BUFFER, _uboSize, NULL, GL_DYNAMIC_DRAW);
-  _f->glBindBufferBase(GL_UNIFORM_BUFFER, _uboIndex, _uboId);
-#else
-  qDebug("Texture-based shader parameter mechanism");
-  //use texture as shader parameter mechanism
-  //create texture for float data
-  glGenTextures(1, &_floatStorageTexId);
-  glBindTexture(GL_TEXTURE_2D, _floatStorageTexId);
-  //we're using this texture as storage, so do not want mipmapping
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  //create the storage
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 10, 1, 0, GL_RGBA, GL_FLOAT, NULL);
-
-  //create texture for int data
-  glGenTextures(1, &_intStorageTexId);
-  glBindTexture(GL_TEXTURE_2D, _intStorageTexId);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32I, 10, 1, 0, GL_RGBA_INTEGER, GL_INT, NULL);
-#endif
+  //repaint to upload the image once it is decoded and to show it once it is uploaded
+  TextureLoader *loader = SharedResources::current()->textureLoader();
+  connect(loader, SIGNAL(decoded()), this, SLOT(update()));
+  connect(loader, SIGNAL(loaded(QString)), this, SLOT(update()));
+  //and to draw the cube instead of the clear once the programs are linked
+  connect(SharedResources::current()->shaderCompiler(), SIGNAL(compiled()), this, SLOT(update()));
+}
 
-  _vao.release();
+CubeState GLWidget::state() const
+{
+  CubeState state;
+  state.clearColor = _clearColor;
+  state.xRot = _xRot;
+  state.yRot = _yRot;
+  state.zRot = _zRot;
+  state.rotIndex = _rotIndex;
+  return state;
 }
 
 void GLWidget::paintGL()
 {
-  glClearColor(_clearColor.red(), _clearColor.green(), _clearColor.blue(), _clearColor.alpha());
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-  _vao.bind();
-
-  QMatrix4x4 m;
-  m.ortho(-0.5f, +0.5f, +0.5f, -0.5f, 4.0f, 15.0f);
-  m.translate(0.0f, 0.0f, -10.0f);
-  m.rotate(_xRot / 16.0f, 1.0f, 0.0f, 0.0f);
-  m.rotate(_yRot / 16.0f, 0.0f, 1.0f, 0.0f);
-  m.rotate(_zRot / 16.0f, 0.0f, 0.0f, 1.0f);
-
-  if (_rotIndex == 0) {
-    int material[4] = {1,0,0,0};
-    memcpy(_buffer, m.constData(), 16*sizeof(GLfloat));
-    memcpy(&_buffer[16], material, 4*sizeof(GLint));
+  _statistics.beginPaint();
+  //in low latency mode this waits for the previous frame, so the rotation applied below is the latest
+  _latency->beginFrame();
+  _xRot += _pendingXRot;
+  _yRot += _pendingYRot;
+  _zRot += _pendingZRot;
+  _pendingXRot = _pendingYRot = _pendingZRot = 0;
+
+  //QOpenGLWidget and the overlay's QPainter change bindings between frames
+  GLStateCache::current()->invalidate();
+  _paintedState = state();
+  _painted = true;
+  _renderer->render(_paintedState);
+  //as a failure in initializeGL(), only found once the background compile is done
+  if (_renderer->hasFailed()) {
+    exit(EXIT_FAILURE);
   }
-  else {
-    QMatrix4x4 n = m;
-    n.scale(0.5, 0.5, 0.5);
-    int material[4] = {7,0,0,0};
-    memcpy(_buffer, n.constData(), 16*sizeof(GLfloat));
-    memcpy(&_buffer[16], material, 4*sizeof(GLint));
+  //the widget's framebuffer is bound, the overlay is not captured
+  if (_capture) {
+    _capture->capture(QRect(QPoint(0, 0), size() * devicePixelRatio()));
   }
 
-#ifdef USE_UBO
-  //update UBO
-  glBindBuffer(GL_UNIFORM_BUFFER, _uboId);
-  if (_rotIndex == 0) {
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, 16*sizeof(GLfloat)+4*sizeof(GLint), _buffer);
-  }
-  else {
-    glBufferSubData(GL_UNIFORM_BUFFER, 16*sizeof(GLfloat)+4*sizeof(GLint), 16*sizeof(GLfloat)+4*sizeof(GLint), _buffer);
-  }
-#else
-  //update float texture
-  glActiveTexture(GL_TEXTURE1);
-  _program->setUniformValue("floatSampler", 1);
-  glBindTexture(GL_TEXTURE_2D, _floatStorageTexId);
-  if (_rotIndex == 0) {
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 5, 1, GL_RGBA, GL_FLOAT, _buffer);
+  if (GpuProfiler::isOverlayEnabled() && _renderer->profiler()) {
+    drawProfilerOverlay();
   }
-  else {
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 5, 0, 5, 1, GL_RGBA, GL_FLOAT, _buffer);
-  }
-  //update int texture
-  glActiveTexture(GL_TEXTURE2);
-  _program->setUniformValue("intSampler", 2);
-  glBindTexture(GL_TEXTURE_2D, _intStorageTexId);
-  if (_rotIndex == 0) {
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 5, 1, GL_RGBA_INTEGER, GL_INT, _buffer);
-  }
-  else {
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 5, 0, 5, 1, GL_RGBA_INTEGER, GL_INT, _buffer);
-  }
-
-#endif
+  _latency->endFrame();
+  _statistics.endPaint();
+}
 
-  _program->setUniformValue("rotIndex", _rotIndex);
-  _program->enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
-  _program->enableAttributeArray(PROGRAM_TEXCOORD_ATTRIBUTE);
-  _program->setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3, 5 * sizeof(GLfloat));
-  _program->setAttributeBuffer(PROGRAM_TEXCOORD_ATTRIBUTE, GL_FLOAT, 3 * sizeof(GLfloat), 2, 5 * sizeof(GLfloat));
+const GpuProfiler *GLWidget::gpuProfiler() const
+{
+  return _renderer ? _renderer->profiler() : 0;
+}
 
-  glActiveTexture(GL_TEXTURE0);
-  _texture->bind();
-  for (int i = 0; i < 6; ++i) {
-    glDrawArrays(GL_TRIANGLE_FAN, i * 4, 4);
+void GLWidget::drawProfilerOverlay()
+{
+  const QString text = _renderer->profiler()->overlayText();
+  if (text.isEmpty()) {
+    return;
   }
-  _vao.release();
+
+  QPainter painter(this);
+  painter.setPen(Qt::white);
+  painter.drawText(rect().adjusted(4, 4, -4, -4), Qt::AlignLeft | Qt::AlignTop, text);
 }
 
 void GLWidget::toggleRotationIndex()
 {
   _rotIndex = (_rotIndex == 0) ? 1 : 0;
-  update();
+  if (_renderer) {
+    _renderer->prepare(state());
+  }
+  updateState();
 }
 
 void GLWidget::resizeGL(int width, int height)
 {
-  int side = qMin(width, height);
-  glViewport((width - side) / 2, (height - side) / 2, side, side);
+  _renderer->resize(width, height);
 }
 
 void GLWidget::mousePressEvent(QMouseEvent *event)
@@ -389,50 +225,29 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
 {
   int dx = event->x() - _lastPos.x();
   int dy = event->y() - _lastPos.y();
-
-  if (event->buttons() & Qt::LeftButton) {
-    rotateBy(8 * dy, 8 * dx, 0);
-  } else if (event->buttons() & Qt::RightButton) {
-    rotateBy(8 * dy, 0, 8 * dx);
-  }
   _lastPos = event->pos();
+  if ((dx == 0 && dy == 0) || !(event->buttons() & (Qt::LeftButton | Qt::RightButton))) {
+    return;
+  }
+  _latency->inputReceived();
+
+  const int xAngle = 8 * dy;
+  const int yAngle = (event->buttons() & Qt::LeftButton) ? 8 * dx : 0;
+  const int zAngle = (event->buttons() & Qt::LeftButton) ? 0 : 8 * dx;
+  if (InputLatency::isLowLatencyEnabled()) {
+    //all moves queued until the paint become one rotation, applied by paintGL() itself so nothing is
+    //prepared ahead for a state that a later move makes stale
+    _pendingXRot += xAngle;
+    _pendingYRot += yAngle;
+    _pendingZRot += zAngle;
+    _statistics.updateRequested();
+    update();
+  } else {
+    rotateBy(xAngle, yAngle, zAngle);
+  }
 }
 
 void GLWidget::mouseReleaseEvent(QMouseEvent * /* event */)
 {
   emit clicked();
 }
-
-void GLWidget::makeObject()
-{
-  static const int coords[6][4][3] = {
-    { { +1, -1, -1 }, { -1, -1, -1 }, { -1, +1, -1 }, { +1, +1, -1 } },
-    { { +1, +1, -1 }, { -1, +1, -1 }, { -1, +1, +1 }, { +1, +1, +1 } },
-    { { +1, -1, +1 }, { +1, -1, -1 }, { +1, +1, -1 }, { +1, +1, +1 } },
-    { { -1, -1, -1 }, { -1, -1, +1 }, { -1, +1, +1 }, { -1, +1, -1 } },
-    { { +1, -1, +1 }, { -1, -1, +1 }, { -1, -1, -1 }, { +1, -1, -1 } },
-    { { -1, -1, +1 }, { +1, -1, +1 }, { +1, +1, +1 }, { -1, +1, +1 } }
-  };
-
-  _texture = new QOpenGLTexture(QImage(_texturePath).mirrored());
-  _texture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
-  _texture->setMagnificationFilter(QOpenGLTexture::Linear);
-
-  QVector<GLfloat> vertData;
-  for (int i = 0; i < 6; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      // vertex position
-      vertData.append(0.2 * coords[i][j][0]);
-      vertData.append(0.2 * coords[i][j][1]);
-      vertData.append(0.2 * coords[i][j][2]);
-      // texture coordinate
-      vertData.append(j == 0 || j == 3);
-      vertData.append(j == 0 || j == 1);
-    }
-  }
-
-  //create vertex buffer
-  glGenBuffers(1, &_vboId);
-  glBindBuffer(GL_ARRAY_BUFFER, _vboId);
-  glBufferData(GL_ARRAY_BUFFER, vertData.count() * sizeof(GLfloat), vertData.constData(), GL_STATIC_DRAW);
-}
@@ -42,11 +42,16 @@
 #define GLWIDGET_H
 
 #include <QtWidgets>
-#include <QOpenGLFunctions>
 
-QT_FORWARD_DECLARE_CLASS(QGLShaderProgram);
+#include "CubeState.h"
+#include "FrameStatistics.h"
 
-class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+class CubeRenderer;
+class FrameCapture;
+class GpuProfiler;
+class InputLatency;
+
+class GLWidget : public QOpenGLWidget
 {
   Q_OBJECT
 
@@ -59,6 +64,10 @@ public:
   void rotateBy(int xAngle, int yAngle, int zAngle);
   void setClearColor(const QColor &color);
   void toggleRotationIndex();
+  // null unless GPU profiling is enabled and supported by the context
+  const GpuProfiler *gpuProfiler() const;
+  // CPU time of paintGL(), the latency of the updates of the state and of the mouse input
+  const FrameStatistics &frameStatistics() const { return _statistics; }
 
 signals:
   void clicked();
@@ -72,7 +81,10 @@ protected:
   void mouseReleaseEvent(QMouseEvent *event);
 
 private:
-  void makeObject();
+  CubeState state() const;
+  // schedules a repaint unless the state is back to what was painted last
+  void updateState();
+  void drawProfilerOverlay();
 
   QColor _clearColor;
   QPoint _lastPos;
@@ -80,25 +92,19 @@ private:
   int _yRot;
   int _zRot;
   int _rotIndex;
-
-  QOpenGLShaderProgram* _program;
-  QOpenGLVertexArrayObject _vao;
-  QOpenGLTexture* _texture;
-  GLfloat _buffer[20];
+  //mouse rotation not applied yet, coalesced into the next paint in low latency mode
+  int _pendingXRot;
+  int _pendingYRot;
+  int _pendingZRot;
+  CubeState _paintedState;
+  bool _painted;
 
   QString _texturePath;
-
-#ifdef USE_UBO
-  GLuint _uboId;
-  GLuint _uboIndex;
-  GLint _uboSize;
-#else
-  GLuint _floatStorageTexId;
-  GLuint _intStorageTexId;
-#endif
-  GLuint _vboId;
-
-  QOpenGLExtraFunctions *_f;
+  CubeRenderer *_renderer;
+  //null unless frames are captured
+  FrameCapture *_capture;
+  FrameStatistics _statistics;
+  InputLatency *_latency;
 };
 
 #endif
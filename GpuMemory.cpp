@@ -0,0 +1,159 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QSet>
+
+#include "GpuMemory.h"
+
+Q_LOGGING_CATEGORY(lcGpuMemory, "textures.memory", QtInfoMsg)
+
+qint64 GpuMemory::_budget = 0;
+
+static const char *kindNameTable[] = { "textures", "buffers", "parameters" };
+
+static QString megabytes(qint64 bytes)
+{
+  return QString::number(bytes / (1024.0 * 1024.0), 'f', 2) + QStringLiteral(" MiB");
+}
+
+GpuMemory::GpuMemory(QObject *parent)
+  : QObject(parent),
+    _totalBytes(0)
+{
+  for (int i = 0; i < KindCount; ++i) {
+    _kindBytes[i] = 0;
+  }
+}
+
+void GpuMemory::track(const void *object, Kind kind, const QString &name, qint64 bytes)
+{
+  QHash<const void *, Entry>::iterator it = _entries.find(object);
+  if (it == _entries.end()) {
+    Entry entry;
+    entry.kind = kind;
+    entry.name = name;
+    entry.bytes = 0;
+    it = _entries.insert(object, entry);
+  }
+  _totalBytes += bytes - it->bytes;
+  _kindBytes[it->kind] += bytes - it->bytes;
+  it->bytes = bytes;
+}
+
+void GpuMemory::untrack(const void *object)
+{
+  QHash<const void *, Entry>::iterator it = _entries.find(object);
+  if (it == _entries.end()) {
+    return;
+  }
+  _totalBytes -= it->bytes;
+  _kindBytes[it->kind] -= it->bytes;
+  _entries.erase(it);
+}
+
+void GpuMemory::addOwner(const void *object, const QString &owner)
+{
+  QHash<const void *, Entry>::iterator it = _entries.find(object);
+  if (it != _entries.end()) {
+    it->owners.append(owner);
+  }
+}
+
+void GpuMemory::removeOwner(const void *object, const QString &owner)
+{
+  QHash<const void *, Entry>::iterator it = _entries.find(object);
+  if (it != _entries.end()) {
+    it->owners.removeOne(owner);
+  }
+}
+
+qint64 GpuMemory::ownerBytes(const QString &owner) const
+{
+  qint64 bytes = 0;
+  foreach (const Entry &entry, _entries) {
+    if (entry.owners.contains(owner)) {
+      bytes += entry.bytes;
+    }
+  }
+  return bytes;
+}
+
+QStringList GpuMemory::owners() const
+{
+  QSet<QString> owners;
+  foreach (const Entry &entry, _entries) {
+    foreach (const QString &owner, entry.owners) {
+      owners.insert(owner);
+    }
+  }
+  QStringList sorted = owners.toList();
+  sorted.sort();
+  return sorted;
+}
+
+void GpuMemory::report() const
+{
+  if (!lcGpuMemory().isDebugEnabled()) {
+    return;
+  }
+
+  QString line = QStringLiteral("GPU memory ") + megabytes(_totalBytes);
+  if (_budget > 0) {
+    line += QStringLiteral(" of ") + megabytes(_budget);
+  }
+  for (int i = 0; i < KindCount; ++i) {
+    line += QString(", %1 %2").arg(QLatin1String(kindNameTable[i]), megabytes(_kindBytes[i]));
+  }
+  qCDebug(lcGpuMemory, "%s", qPrintable(line));
+  foreach (const QString &owner, owners()) {
+    qCDebug(lcGpuMemory, "  %s: %s", qPrintable(owner), qPrintable(megabytes(ownerBytes(owner))));
+  }
+}
+
+qint64 GpuMemory::budget()
+{
+  return _budget;
+}
+
+void GpuMemory::setBudget(qint64 bytes)
+{
+  _budget = qMax(Q_INT64_C(0), bytes);
+}
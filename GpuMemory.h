@@ -0,0 +1,112 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+#include <QHash>
+#include <QLoggingCategory>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+Q_DECLARE_LOGGING_CATEGORY(lcGpuMemory)
+
+// Estimated GPU memory of the GL objects of a share group: textures with their mip chains, vertex
+// and index buffers, and the parameter storage of every renderer. Each object is tracked with its
+// size and the owners drawing with it, the renderers, named after their widget or tile, so usage
+// can be reported per owner. An object shared by several owners counts fully for each of them and
+// once in the total.
+//
+// The budget is enforced by the TextureLoader, which evicts the least recently drawn textures while
+// the total is over it; buffers and parameter storage stay resident as long as their owner. Only
+// used from the thread of the share group's contexts.
+class GpuMemory : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum Kind {
+    Texture,
+    Buffer,      // vertex and index buffers
+    Parameters,  // parameter storage
+    KindCount
+  };
+
+  explicit GpuMemory(QObject *parent = 0);
+
+  // adds object, or changes the size of a tracked one
+  void track(const void *object, Kind kind, const QString &name, qint64 bytes);
+  void untrack(const void *object);
+  void addOwner(const void *object, const QString &owner);
+  void removeOwner(const void *object, const QString &owner);
+
+  qint64 totalBytes() const { return _totalBytes; }
+  qint64 bytes(Kind kind) const { return _kindBytes[kind]; }
+  // of every object the owner draws with
+  qint64 ownerBytes(const QString &owner) const;
+  QStringList owners() const;
+  bool isOverBudget() const { return _budget > 0 && _totalBytes > _budget; }
+
+  // logs the total and the usage per owner to textures.memory, if its debug output is enabled
+  void report() const;
+
+  // in bytes, 0 for no limit
+  static qint64 budget();
+  static void setBudget(qint64 bytes);
+
+private:
+  struct Entry
+  {
+    Kind kind;
+    QString name;
+    qint64 bytes;
+    QStringList owners;
+  };
+
+  QHash<const void *, Entry> _entries;
+  qint64 _totalBytes;
+  qint64 _kindBytes[KindCount];
+
+  static qint64 _budget;
+};
+
+#endif
@@ -0,0 +1,259 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QOpenGLContext>
+#include <QDebug>
+
+#include "GpuProfiler.h"
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+Q_LOGGING_CATEGORY(lcGpuProfiler, "textures.gpu", QtInfoMsg)
+
+bool GpuProfiler::_enabled = false;
+bool GpuProfiler::_overlayEnabled = false;
+
+static const char *stageNameTable[] = { "clear", "upload", "draw" };
+
+//number of read back frames averaged into one log line
+static const int SummaryInterval = 120;
+
+GpuProfiler::GpuProfiler(int latency)
+  : _f(0),
+    _glQueryCounter(0),
+    _glGetQueryObjectui64v(0),
+    _checkDisjoint(false),
+    _latency(qMax(2, latency)),
+    _current(0),
+    _frame(0),
+    _droppedFrames(0),
+    _summed(0)
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+  destroy();
+}
+
+bool GpuProfiler::initialize()
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  _f = context->extraFunctions();
+
+  if (context->isOpenGLES()) {
+    //GLES only has timestamps through EXT_disjoint_timer_query
+    if (!context->hasExtension(QByteArrayLiteral("GL_EXT_disjoint_timer_query"))) {
+      qCInfo(lcGpuProfiler, "GL_EXT_disjoint_timer_query is not available, GPU profiling disabled");
+      return false;
+    }
+    _glQueryCounter = reinterpret_cast<QueryCounterProc>(context->getProcAddress("glQueryCounterEXT"));
+    _glGetQueryObjectui64v = reinterpret_cast<GetQueryObjectui64vProc>(context->getProcAddress("glGetQueryObjectui64vEXT"));
+    _checkDisjoint = true;
+  }
+  else {
+    if (context->format().version() < qMakePair(3, 3) && !context->hasExtension(QByteArrayLiteral("GL_ARB_timer_query"))) {
+      qCInfo(lcGpuProfiler, "Timer queries are not available, GPU profiling disabled");
+      return false;
+    }
+    _glQueryCounter = reinterpret_cast<QueryCounterProc>(context->getProcAddress("glQueryCounter"));
+    _glGetQueryObjectui64v = reinterpret_cast<GetQueryObjectui64vProc>(context->getProcAddress("glGetQueryObjectui64v"));
+  }
+  if (!_glQueryCounter || !_glGetQueryObjectui64v) {
+    qCInfo(lcGpuProfiler, "Timer query functions could not be resolved, GPU profiling disabled");
+    return false;
+  }
+
+  _slots.resize(_latency);
+  for (int i = 0; i < _slots.count(); ++i) {
+    _f->glGenQueries(StageCount + 1, _slots[i].queries);
+  }
+  return true;
+}
+
+void GpuProfiler::destroy()
+{
+  for (int i = 0; i < _slots.count(); ++i) {
+    _f->glDeleteQueries(StageCount + 1, _slots[i].queries);
+  }
+  _slots.clear();
+  _current = 0;
+}
+
+void GpuProfiler::beginFrame()
+{
+  if (!isActive()) {
+    return;
+  }
+
+  if (_checkDisjoint) {
+    //a disjoint event invalidates every query in flight
+    GLint disjoint = 0;
+    _f->glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint) {
+      for (int i = 0; i < _slots.count(); ++i) {
+        if (_slots[i].pending) {
+          _slots[i].pending = false;
+          ++_droppedFrames;
+        }
+      }
+    }
+  }
+
+  //read back every slot that has finished, oldest first
+  for (int i = 1; i <= _slots.count(); ++i) {
+    Slot &slot = _slots[(_frame + i) % _slots.count()];
+    if (slot.pending) {
+      collect(slot);
+    }
+  }
+
+  _current = &_slots[_frame % _slots.count()];
+  if (_current->pending) {
+    //still not available after a full ring of frames, drop it rather than wait
+    _current->pending = false;
+    ++_droppedFrames;
+  }
+  _current->frame = _frame;
+  _glQueryCounter(_current->queries[0], GL_TIMESTAMP);
+}
+
+void GpuProfiler::mark(Stage stage)
+{
+  if (_current) {
+    _glQueryCounter(_current->queries[stage + 1], GL_TIMESTAMP);
+  }
+}
+
+void GpuProfiler::endFrame()
+{
+  if (_current) {
+    _current->pending = true;
+    _current = 0;
+    ++_frame;
+  }
+}
+
+void GpuProfiler::collect(Slot &slot)
+{
+  GLuint available = 0;
+  _f->glGetQueryObjectuiv(slot.queries[StageCount], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return;
+  }
+
+  GLuint64 timestamps[StageCount + 1];
+  for (int i = 0; i <= StageCount; ++i) {
+    _glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+  }
+  slot.pending = false;
+
+  if (slot.frame < _last.frame) {
+    return;
+  }
+  _last.frame = slot.frame;
+  for (int i = 0; i < StageCount; ++i) {
+    _last.stages[i] = timestamps[i + 1] - timestamps[i];
+    _sum.stages[i] += _last.stages[i];
+  }
+  _last.total = timestamps[StageCount] - timestamps[0];
+  _sum.total += _last.total;
+
+  if (++_summed == SummaryInterval) {
+    logSummary();
+  }
+}
+
+void GpuProfiler::logSummary()
+{
+  if (lcGpuProfiler().isDebugEnabled()) {
+    QString line = QString("frame %1:").arg(_last.frame);
+    for (int i = 0; i < StageCount; ++i) {
+      line += QString(" %1 %2us").arg(stageName(static_cast<Stage>(i))).arg(_sum.stages[i] / 1000.0 / _summed, 0, 'f', 1);
+    }
+    line += QString(" total %1us dropped %2").arg(_sum.total / 1000.0 / _summed, 0, 'f', 1).arg(_droppedFrames);
+    qCDebug(lcGpuProfiler) << qPrintable(line);
+  }
+  _sum = Timings();
+  _summed = 0;
+}
+
+QString GpuProfiler::overlayText() const
+{
+  if (_last.frame < 0) {
+    return QString();
+  }
+
+  return QString("clear %1 us\nupload %2 us\ndraw %3 us\ngpu %4 us")
+      .arg(_last.stages[Clear] / 1000.0, 0, 'f', 1)
+      .arg(_last.stages[Upload] / 1000.0, 0, 'f', 1)
+      .arg(_last.stages[Draw] / 1000.0, 0, 'f', 1)
+      .arg(_last.total / 1000.0, 0, 'f', 1);
+}
+
+QString GpuProfiler::stageName(Stage stage)
+{
+  return QString::fromLatin1(stageNameTable[stage]);
+}
+
+bool GpuProfiler::isEnabled()
+{
+  return _enabled;
+}
+
+void GpuProfiler::setEnabled(bool enabled)
+{
+  _enabled = enabled;
+}
+
+bool GpuProfiler::isOverlayEnabled()
+{
+  return _overlayEnabled;
+}
+
+void GpuProfiler::setOverlayEnabled(bool enabled)
+{
+  _overlayEnabled = enabled;
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <QLoggingCategory>
+#include <QString>
+#include <QVector>
+#include <QOpenGLExtraFunctions>
+
+Q_DECLARE_LOGGING_CATEGORY(lcGpuProfiler)
+
+// Times the stages of a frame on the GPU with timestamp queries. Queries are kept in a ring
+// that is read back Latency frames later; a frame whose results are not available by then is
+// dropped instead of waited for, so profiling never stalls the pipeline.
+class GpuProfiler
+{
+public:
+  enum Stage {
+    Clear,
+    Upload,
+    Draw,
+    StageCount
+  };
+
+  struct Timings
+  {
+    Timings() : frame(-1), total(0) { for (int i = 0; i < StageCount; ++i) stages[i] = 0; }
+
+    qint64 frame;
+    qint64 stages[StageCount];  // nanoseconds
+    qint64 total;
+  };
+
+  explicit GpuProfiler(int latency = 4);
+  ~GpuProfiler();
+
+  // needs a current context, returns false when timestamp queries are not available
+  bool initialize();
+  void destroy();
+  bool isActive() const { return !_slots.isEmpty(); }
+
+  void beginFrame();
+  void mark(Stage stage);
+  void endFrame();
+
+  // the most recent frame whose results have been read back
+  const Timings &lastTimings() const { return _last; }
+  qint64 droppedFrames() const { return _droppedFrames; }
+  // lastTimings() as a few lines of text for an on-screen overlay, empty before the first readback
+  QString overlayText() const;
+
+  static QString stageName(Stage stage);
+
+  static bool isEnabled();
+  static void setEnabled(bool enabled);
+  static bool isOverlayEnabled();
+  static void setOverlayEnabled(bool enabled);
+
+private:
+  typedef void (QOPENGLF_APIENTRYP QueryCounterProc)(GLuint id, GLenum target);
+  typedef void (QOPENGLF_APIENTRYP GetQueryObjectui64vProc)(GLuint id, GLenum pname, GLuint64 *params);
+
+  struct Slot
+  {
+    Slot() : frame(-1), pending(false) {}
+
+    GLuint queries[StageCount + 1];
+    qint64 frame;
+    bool pending;
+  };
+
+  void collect(Slot &slot);
+  void logSummary();
+
+  QOpenGLExtraFunctions *_f;
+  QueryCounterProc _glQueryCounter;
+  GetQueryObjectui64vProc _glGetQueryObjectui64v;
+  bool _checkDisjoint;
+
+  int _latency;
+  QVector<Slot> _slots;
+  Slot *_current;
+  qint64 _frame;
+  qint64 _droppedFrames;
+  Timings _last;
+  Timings _sum;
+  int _summed;
+
+  static bool _enabled;
+  static bool _overlayEnabled;
+};
+
+#endif
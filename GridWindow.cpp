@@ -0,0 +1,329 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QMouseEvent>
+#include <QPainter>
+
+#include <algorithm>
+
+#include "AnimationScheduler.h"
+#include "FrameCapture.h"
+#include "GLStateCache.h"
+#include "GpuProfiler.h"
+#include "GridWindow.h"
+#include "InputLatency.h"
+#include "ShaderCompiler.h"
+#include "SharedResources.h"
+#include "TextureLoader.h"
+
+GridWindow::GridWindow(int rows, int columns)
+  : QOpenGLWindow(PartialUpdateBlit),
+    _rows(qMax(1, rows)),
+    _columns(qMax(1, columns)),
+    _currentTile(0),
+    _pressedTile(-1),
+    _rotationSpeed(2),
+    _repaintAll(true),
+    _animation(new AnimationScheduler(this)),
+    _capture(0),
+    _statistics(QStringLiteral("grid")),
+    _latency(new InputLatency(this, &_statistics))
+{
+  _tiles.resize(_rows * _columns);
+  const int count = _tiles.count();
+  for (int i = 0; i < _rows; ++i) {
+    for (int j = 0; j < _columns; ++j) {
+      const int index = i * _columns + j;
+      QColor clearColor;
+      clearColor.setHsv(index * 255 / qMax(1, count - 1), 255, 63);
+
+      _tiles[index].texturePath = QString(":/images/side%1.png").arg(index % 6 + 1);
+      setClearColor(i, j, clearColor);
+    }
+  }
+
+  _animation->setSurface(this);
+  _animation->setStepAngle(_rotationSpeed * 16);
+  connect(_animation, SIGNAL(advance(int)), this, SLOT(rotateCurrent(int)));
+  _animation->start();
+
+  setTitle(tr("Textures"));
+  resize(qMin(200 * _columns, 1600), qMin(200 * _rows, 1000));
+}
+
+GridWindow::~GridWindow()
+{
+  makeCurrent();
+  _latency->destroy();
+  if (_capture) {
+    _capture->finish();
+    delete _capture;
+  }
+  for (int i = 0; i < _tiles.count(); ++i) {
+    delete _tiles[i].renderer;
+  }
+  doneCurrent();
+}
+
+void GridWindow::setClearColor(int row, int column, const QColor &color)
+{
+  const int index = row * _columns + column;
+  _tiles[index].state.clearColor = color;
+  updateTile(index);
+}
+
+void GridWindow::initializeGL()
+{
+  //the program, texture and vertex buffer are shared, only the parameter storage is per tile
+  for (int i = 0; i < _tiles.count(); ++i) {
+    Tile &tile = _tiles[i];
+    tile.renderer = new CubeRenderer(tile.texturePath, ParameterStorage::selectedBackend(), CubeRenderer::selectedInstanceCount());
+    tile.renderer->setName(QStringLiteral("grid tile %1").arg(i));
+    if (!tile.renderer->initialize()) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (FrameCapture::isEnabled()) {
+    _capture = new FrameCapture(QStringLiteral("grid"));
+  }
+
+  TextureLoader *loader = SharedResources::current()->textureLoader();
+  //any tile can upload a decoded image, and any tile may show a loaded one
+  connect(loader, SIGNAL(decoded()), this, SLOT(repaintAll()));
+  connect(loader, SIGNAL(loaded(QString)), this, SLOT(repaintAll()));
+  //tiles that only got their clear color are redrawn once their programs are linked
+  connect(SharedResources::current()->shaderCompiler(), SIGNAL(compiled()), this, SLOT(repaintAll()));
+}
+
+void GridWindow::resizeGL(int /* width */, int /* height */)
+{
+  //the preserved content is recreated at the new size
+  _repaintAll = true;
+}
+
+void GridWindow::repaintAll()
+{
+  _repaintAll = true;
+  _statistics.updateRequested();
+  update();
+}
+
+bool GridWindow::isDirty(int index) const
+{
+  const Tile &tile = _tiles[index];
+  return !tile.painted || tile.state != tile.paintedState;
+}
+
+void GridWindow::updateTile(int index)
+{
+  if (isDirty(index)) {
+    _statistics.updateRequested();
+    update();
+  }
+}
+
+void GridWindow::paintGL()
+{
+  _statistics.beginPaint();
+  //in low latency mode this waits for the previous frame, so the rotation applied below is the latest
+  _latency->beginFrame();
+  for (int i = 0; i < _tiles.count(); ++i) {
+    Tile &tile = _tiles[i];
+    tile.state.xRot += tile.pendingXRot;
+    tile.state.yRot += tile.pendingYRot;
+    tile.state.zRot += tile.pendingZRot;
+    tile.pendingXRot = tile.pendingYRot = tile.pendingZRot = 0;
+  }
+
+  //the tiles share the cached bindings, only QOpenGLWindow and the overlay change them behind its back
+  GLStateCache::current()->invalidate();
+  //the overlay text is drawn over every tile, so it needs them all redrawn
+  const bool repaintAll = _repaintAll || GpuProfiler::isOverlayEnabled();
+  //tiles drawn with the same material permutation follow each other, so the program changes least often
+  QVector<QPair<Material::Set, int> > order;
+  for (int i = 0; i < _tiles.count(); ++i) {
+    if (repaintAll || isDirty(i)) {
+      order.append(qMakePair(_tiles[i].renderer->permutation(_tiles[i].state), i));
+    }
+  }
+  std::sort(order.begin(), order.end());
+
+  const QSize size = this->size() * devicePixelRatio();
+  for (int j = 0; j < order.count(); ++j) {
+    const int i = order[j].second;
+    Tile &tile = _tiles[i];
+    //GL window coordinates start at the bottom left
+    const QRect rect = tileRect(i, _rows, _columns, size);
+    tile.renderer->setTile(QRect(rect.x(), size.height() - rect.y() - rect.height(), rect.width(), rect.height()));
+    tile.renderer->render(tile.state);
+    //as a failure in initializeGL(), only found once the background compile is done
+    if (tile.renderer->hasFailed()) {
+      exit(EXIT_FAILURE);
+    }
+    tile.paintedState = tile.state;
+    tile.painted = true;
+  }
+  _repaintAll = false;
+  //the preserved content holds every tile, drawn this frame or not; the overlay is not captured
+  if (_capture) {
+    _capture->capture(QRect(QPoint(0, 0), size));
+  }
+
+  if (GpuProfiler::isOverlayEnabled()) {
+    drawProfilerOverlay();
+  }
+  _latency->endFrame();
+  _statistics.endPaint();
+}
+
+void GridWindow::drawProfilerOverlay()
+{
+  QPainter painter(this);
+  painter.setPen(Qt::white);
+  for (int i = 0; i < _tiles.count(); ++i) {
+    const GpuProfiler *profiler = _tiles[i].renderer->profiler();
+    const QString text = profiler ? profiler->overlayText() : QString();
+    if (!text.isEmpty()) {
+      painter.drawText(tileRect(i, _rows, _columns, this->size()).adjusted(4, 4, -4, -4), Qt::AlignLeft | Qt::AlignTop, text);
+    }
+  }
+}
+
+QRect GridWindow::tileRect(int index, int rows, int columns, const QSize &size)
+{
+  const int row = index / columns;
+  const int column = index % columns;
+  const int left = column * size.width() / columns;
+  const int top = row * size.height() / rows;
+  const int right = (column + 1) * size.width() / columns;
+  const int bottom = (row + 1) * size.height() / rows;
+  return QRect(left, top, right - left, bottom - top);
+}
+
+int GridWindow::tileAt(const QPoint &pos, int rows, int columns, const QSize &size)
+{
+  if (!QRect(QPoint(0, 0), size).contains(pos)) {
+    return -1;
+  }
+  const int row = pos.y() * rows / size.height();
+  const int column = pos.x() * columns / size.width();
+  return row * columns + column;
+}
+
+void GridWindow::rotateTile(int index, int xAngle, int yAngle, int zAngle)
+{
+  if (xAngle == 0 && yAngle == 0 && zAngle == 0) {
+    return;
+  }
+  Tile &tile = _tiles[index];
+  tile.state.xRot += xAngle;
+  tile.state.yRot += yAngle;
+  tile.state.zRot += zAngle;
+  //the instance parameters are prepared on the worker threads until the window is painted
+  if (tile.renderer) {
+    tile.renderer->prepare(tile.state);
+  }
+  updateTile(index);
+}
+
+void GridWindow::mousePressEvent(QMouseEvent *event)
+{
+  _pressedTile = tileAt(event->pos(), _rows, _columns, size());
+  _lastPos = event->pos();
+}
+
+void GridWindow::mouseMoveEvent(QMouseEvent *event)
+{
+  if (_pressedTile < 0) {
+    return;
+  }
+
+  int dx = event->x() - _lastPos.x();
+  int dy = event->y() - _lastPos.y();
+  _lastPos = event->pos();
+  if ((dx == 0 && dy == 0) || !(event->buttons() & (Qt::LeftButton | Qt::RightButton))) {
+    return;
+  }
+  _latency->inputReceived();
+
+  const int xAngle = 8 * dy;
+  const int yAngle = (event->buttons() & Qt::LeftButton) ? 8 * dx : 0;
+  const int zAngle = (event->buttons() & Qt::LeftButton) ? 0 : 8 * dx;
+  if (InputLatency::isLowLatencyEnabled()) {
+    //like GLWidget, the moves queued until the paint become one rotation applied by paintGL()
+    Tile &tile = _tiles[_pressedTile];
+    tile.pendingXRot += xAngle;
+    tile.pendingYRot += yAngle;
+    tile.pendingZRot += zAngle;
+    _statistics.updateRequested();
+    update();
+  } else {
+    rotateTile(_pressedTile, xAngle, yAngle, zAngle);
+  }
+}
+
+void GridWindow::mouseReleaseEvent(QMouseEvent * /* event */)
+{
+  //like the GLWidgets, the tile that got the press is the one that is clicked
+  if (_pressedTile < 0) {
+    return;
+  }
+
+  if (_pressedTile == _currentTile) {
+    Tile &tile = _tiles[_currentTile];
+    tile.state.rotIndex = (tile.state.rotIndex == 0) ? 1 : 0;
+    if (tile.renderer) {
+      tile.renderer->prepare(tile.state);
+    }
+    _rotationSpeed = (_rotationSpeed == 2) ? 8 : 2;
+    updateTile(_currentTile);
+  }
+  else {
+    _currentTile = _pressedTile;
+    _rotationSpeed = 2;
+  }
+  _animation->setStepAngle(_rotationSpeed * 16);
+  _pressedTile = -1;
+}
+
+void GridWindow::rotateCurrent(int angle)
+{
+  rotateTile(_currentTile, angle, angle, -1 * angle);
+}
@@ -0,0 +1,129 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef GRIDWINDOW_H
+#define GRIDWINDOW_H
+
+#include <QOpenGLWindow>
+#include <QVector>
+
+#include "CubeRenderer.h"
+#include "FrameStatistics.h"
+
+class AnimationScheduler;
+class FrameCapture;
+class InputLatency;
+
+// Draws a whole grid of cube tiles into a single QOpenGLWindow, one scissored viewport per tile.
+// Behaves like Window with its GLWidgets: click a tile to make it the rotating one, click it again
+// to toggle the rotation index and speed, drag to rotate it. There is one context and no widget
+// compositing, so the cost per tile is only its own draw calls.
+//
+// The window keeps its content between frames (PartialUpdateBlit) and only redraws the tiles
+// whose state changed since they were last drawn.
+class GridWindow : public QOpenGLWindow
+{
+  Q_OBJECT
+
+public:
+  GridWindow(int rows, int columns);
+  ~GridWindow();
+
+  void setClearColor(int row, int column, const QColor &color);
+
+  // the rectangle of a tile in a grid filling a surface of the given size, origin top left
+  static QRect tileRect(int index, int rows, int columns, const QSize &size);
+  // the tile under pos, -1 outside the surface
+  static int tileAt(const QPoint &pos, int rows, int columns, const QSize &size);
+
+  // CPU time of paintGL(), the latency of the updates of the tiles and of the mouse input
+  const FrameStatistics &frameStatistics() const { return _statistics; }
+
+protected:
+  void initializeGL();
+  void resizeGL(int width, int height);
+  void paintGL();
+  void mousePressEvent(QMouseEvent *event);
+  void mouseMoveEvent(QMouseEvent *event);
+  void mouseReleaseEvent(QMouseEvent *event);
+
+private slots:
+  void rotateCurrent(int angle);
+  void repaintAll();
+
+private:
+  struct Tile
+  {
+    Tile() : painted(false), pendingXRot(0), pendingYRot(0), pendingZRot(0), renderer(0) {}
+
+    CubeState state;
+    CubeState paintedState;
+    bool painted;
+    //mouse rotation not applied yet, coalesced into the next paint in low latency mode
+    int pendingXRot;
+    int pendingYRot;
+    int pendingZRot;
+    QString texturePath;
+    CubeRenderer *renderer;
+  };
+
+  void rotateTile(int index, int xAngle, int yAngle, int zAngle);
+  bool isDirty(int index) const;
+  // schedules a repaint if the tile is not showing its state
+  void updateTile(int index);
+  void drawProfilerOverlay();
+
+  int _rows;
+  int _columns;
+  QVector<Tile> _tiles;
+  int _currentTile;
+  int _pressedTile;
+  QPoint _lastPos;
+  int _rotationSpeed;
+  //set when the preserved content is gone or the textures changed
+  bool _repaintAll;
+  AnimationScheduler *_animation;
+  //null unless frames are captured
+  FrameCapture *_capture;
+  FrameStatistics _statistics;
+  InputLatency *_latency;
+};
+
+#endif
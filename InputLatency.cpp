@@ -0,0 +1,177 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include "FrameStatistics.h"
+#include "InputLatency.h"
+
+bool InputLatency::_lowLatencyEnabled = false;
+
+//frames not matched by then are forgotten, some surfaces swap without emitting frameSwapped()
+static const int MaxTrackedFrames = 8;
+//a GPU that takes longer than this is not throttled any further this frame
+static const GLuint64 MaxWait = 100000000;
+
+InputLatency::InputLatency(QObject *surface, FrameStatistics *statistics)
+  : QObject(surface),
+    _statistics(statistics),
+    _context(0),
+    _f(0),
+    _pendingInput(-1)
+{
+  _clock.start();
+  connect(surface, SIGNAL(frameSwapped()), this, SLOT(frameSwapped()));
+}
+
+InputLatency::~InputLatency()
+{
+  Q_ASSERT(_inFlight.isEmpty());
+}
+
+void InputLatency::inputReceived()
+{
+  //the oldest input waits longest for the frame
+  if (_pendingInput < 0) {
+    _pendingInput = _clock.nsecsElapsed();
+  }
+}
+
+void InputLatency::beginFrame()
+{
+  if (!_context) {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    //sync objects are core in GL 3.2 and GLES 3.0
+    const bool hasSync = context->isOpenGLES() ? context->format().majorVersion() >= 3
+                                               : context->format().version() >= qMakePair(3, 2)
+                                                 || context->hasExtension(QByteArrayLiteral("GL_ARB_sync"));
+    _context = context;
+    _f = hasSync ? context->extraFunctions() : 0;
+  }
+  retire(_lowLatencyEnabled);
+}
+
+void InputLatency::endFrame()
+{
+  if (_f) {
+    Frame frame;
+    frame.fence = _f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.input = _pendingInput;
+    _inFlight.append(frame);
+    if (_inFlight.count() > MaxTrackedFrames) {
+      _f->glDeleteSync(_inFlight.takeFirst().fence);
+    }
+  }
+
+  _unswapped.append(_pendingInput);
+  if (_unswapped.count() > MaxTrackedFrames) {
+    _unswapped.removeFirst();
+  }
+  _pendingInput = -1;
+}
+
+void InputLatency::destroy()
+{
+  if (_f) {
+    foreach (const Frame &frame, _inFlight) {
+      _f->glDeleteSync(frame.fence);
+    }
+  }
+  _inFlight.clear();
+  _context = 0;
+  _f = 0;
+}
+
+void InputLatency::frameSwapped()
+{
+  //a window swaps once per paint, widgets are composed into the swap of their top level window
+  //with whatever they painted since the previous one, and are told about swaps they did not paint for
+  const qint64 now = _clock.nsecsElapsed();
+  foreach (qint64 input, _unswapped) {
+    if (input >= 0) {
+      _statistics->record(FrameStatistics::InputToSwap, now - input);
+    }
+  }
+  _unswapped.clear();
+  //a QOpenGLWindow is still current after its swap, a QOpenGLWidget is not
+  if (_context && QOpenGLContext::currentContext() == _context) {
+    retire(false);
+  }
+}
+
+void InputLatency::retire(bool wait)
+{
+  if (!_f) {
+    return;
+  }
+
+  while (!_inFlight.isEmpty()) {
+    const Frame &frame = _inFlight.first();
+    GLenum status = _f->glClientWaitSync(frame.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      if (!wait || _inFlight.count() < MaxFramesInFlight) {
+        break;
+      }
+      _statistics->add(FrameStatistics::ThrottleWaits);
+      status = _f->glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, MaxWait);
+      if (status == GL_TIMEOUT_EXPIRED) {
+        break;
+      }
+    }
+
+    if (frame.input >= 0 && status != GL_WAIT_FAILED) {
+      _statistics->record(FrameStatistics::InputToGpu, _clock.nsecsElapsed() - frame.input);
+    }
+    _f->glDeleteSync(frame.fence);
+    _inFlight.removeFirst();
+  }
+}
+
+bool InputLatency::isLowLatencyEnabled()
+{
+  return _lowLatencyEnabled;
+}
+
+void InputLatency::setLowLatencyEnabled(bool enabled)
+{
+  _lowLatencyEnabled = enabled;
+}
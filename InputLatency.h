@@ -0,0 +1,116 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef INPUTLATENCY_H
+#define INPUTLATENCY_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <qopengl.h>
+
+class FrameStatistics;
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext);
+QT_FORWARD_DECLARE_CLASS(QOpenGLExtraFunctions);
+
+// Follows input events to the frame that shows them. The first input after a paint starts the
+// clock; the frame painted next carries it, and FrameStatistics gets the time until the surface
+// reported frameSwapped() (InputToSwap) and until a fence placed after the frame's commands had
+// signaled (InputToGpu). Fences are polled whenever the context is current, so a GPU time is
+// at most a frame late. For a QOpenGLWidget the fence covers paintGL(), not the composition.
+//
+// In low latency mode beginFrame() also waits until fewer than MaxFramesInFlight frames are still
+// on the GPU, so the CPU cannot queue frames ahead and the input applied after it is as recent as
+// possible. Surfaces then also coalesce mouse moves into one change per frame.
+//
+// All methods but frameSwapped() must be called with the surface's context current.
+class InputLatency : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum { MaxFramesInFlight = 1 };
+
+  // a QOpenGLWidget or QOpenGLWindow, frames are matched to its frameSwapped()
+  InputLatency(QObject *surface, FrameStatistics *statistics);
+  ~InputLatency();
+
+  void inputReceived();
+  // at the start of paintGL(), waits for the GPU in low latency mode
+  void beginFrame();
+  // at the end of paintGL(), fences the frame
+  void endFrame();
+  // deletes the fences
+  void destroy();
+
+  static bool isLowLatencyEnabled();
+  static void setLowLatencyEnabled(bool enabled);
+
+private slots:
+  void frameSwapped();
+
+private:
+  // frames whose fence has not been seen signaled yet
+  struct Frame
+  {
+    GLsync fence;
+    qint64 input;
+  };
+
+  // removes the frames the GPU has finished; with wait, waits until fewer than
+  // MaxFramesInFlight are left
+  void retire(bool wait);
+
+  FrameStatistics *_statistics;
+  QOpenGLContext *_context;
+  QOpenGLExtraFunctions *_f;
+  QElapsedTimer _clock;
+  //time of the first input not painted yet, -1 for none
+  qint64 _pendingInput;
+  QList<Frame> _inFlight;
+  //inputs of the frames painted since the last frameSwapped(), -1 for a frame without input
+  QList<qint64> _unswapped;
+
+  static bool _lowLatencyEnabled;
+};
+
+#endif
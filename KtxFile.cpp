@@ -0,0 +1,145 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <string.h>
+
+#include "KtxFile.h"
+
+namespace {
+
+const uchar KtxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const quint32 KtxEndianness = 0x04030201;
+
+struct KtxHeader
+{
+  uchar identifier[12];
+  quint32 endianness;
+  quint32 glType;
+  quint32 glTypeSize;
+  quint32 glFormat;
+  quint32 glInternalFormat;
+  quint32 glBaseInternalFormat;
+  quint32 pixelWidth;
+  quint32 pixelHeight;
+  quint32 pixelDepth;
+  quint32 numberOfArrayElements;
+  quint32 numberOfFaces;
+  quint32 numberOfMipmapLevels;
+  quint32 bytesOfKeyValueData;
+};
+
+}
+
+KtxFile::KtxFile()
+  : _mapped(0),
+    _internalFormat(0)
+{
+}
+
+KtxFile::~KtxFile()
+{
+  if (_mapped) {
+    _file.unmap(_mapped);
+  }
+}
+
+bool KtxFile::fail(const QString &message)
+{
+  _errorString = _file.fileName() + QStringLiteral(": ") + message;
+  _levels.clear();
+  return false;
+}
+
+bool KtxFile::open(const QString &fileName)
+{
+  _file.setFileName(fileName);
+  if (!_file.open(QIODevice::ReadOnly)) {
+    return fail(_file.errorString());
+  }
+  const qint64 fileSize = _file.size();
+  if (fileSize < qint64(sizeof(KtxHeader))) {
+    return fail(QStringLiteral("truncated header"));
+  }
+  _mapped = _file.map(0, fileSize);
+  if (!_mapped) {
+    return fail(_file.errorString());
+  }
+
+  KtxHeader header;
+  memcpy(&header, _mapped, sizeof(header));
+  if (memcmp(header.identifier, KtxIdentifier, sizeof(KtxIdentifier)) != 0) {
+    return fail(QStringLiteral("not a KTX 1.1 file"));
+  }
+  //written by a machine of the other byte order; none of the encoders we use do that
+  if (header.endianness != KtxEndianness) {
+    return fail(QStringLiteral("byte swapped files are not supported"));
+  }
+  if (header.glType != 0 || header.glFormat != 0) {
+    return fail(QStringLiteral("not compressed"));
+  }
+  if (header.pixelDepth > 1 || header.numberOfArrayElements > 0 || header.numberOfFaces != 1) {
+    return fail(QStringLiteral("not a 2D texture"));
+  }
+  _internalFormat = header.glInternalFormat;
+
+  //each level is preceded by its size and padded to 4 bytes
+  const int levelCount = qMax(1u, header.numberOfMipmapLevels);
+  qint64 offset = sizeof(KtxHeader) + header.bytesOfKeyValueData;
+  for (int i = 0; i < levelCount; ++i) {
+    if (offset + 4 > fileSize) {
+      return fail(QStringLiteral("truncated mip level %1").arg(i));
+    }
+    quint32 imageSize;
+    memcpy(&imageSize, _mapped + offset, 4);
+    offset += 4;
+    if (offset + imageSize > fileSize) {
+      return fail(QStringLiteral("truncated mip level %1").arg(i));
+    }
+
+    Level level;
+    level.width = qMax(1u, header.pixelWidth >> i);
+    level.height = qMax(1u, header.pixelHeight >> i);
+    level.data = _mapped + offset;
+    level.size = imageSize;
+    _levels << level;
+    offset += (imageSize + 3) & ~3u;
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef KTXFILE_H
+#define KTXFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <qopengl.h>
+
+// A KTX 1.1 container holding a compressed 2D texture with its mip chain (as written by
+// PVRTexToolCLI, toktx or etcpack). The file is memory mapped and the levels point into the
+// mapping, so they can be handed to glCompressedTexImage2D without a copy. Arrays, cube maps
+// and uncompressed data are rejected.
+class KtxFile
+{
+public:
+  struct Level
+  {
+    int width;
+    int height;
+    const uchar *data;
+    int size;
+  };
+
+  KtxFile();
+  ~KtxFile();
+
+  bool open(const QString &fileName);
+  QString errorString() const { return _errorString; }
+
+  GLenum internalFormat() const { return _internalFormat; }
+  int width() const { return _levels.isEmpty() ? 0 : _levels.first().width; }
+  int height() const { return _levels.isEmpty() ? 0 : _levels.first().height; }
+  const QVector<Level> &levels() const { return _levels; }
+
+private:
+  bool fail(const QString &message);
+
+  QFile _file;
+  uchar *_mapped;
+  GLenum _internalFormat;
+  QVector<Level> _levels;
+  QString _errorString;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QOpenGLShaderProgram>
+#include <QVector4D>
+
+#include "Material.h"
+
+static_assert(Material::Count <= 32, "a Material::Set holds one bit per id");
+
+namespace {
+
+struct MaterialInfo
+{
+  int id;
+  const char *name;
+  GLfloat color[4];
+  GLfloat amount;
+};
+
+const MaterialInfo materialInfo[] = {
+#define MATERIAL(Name, id, red, green, blue, alpha, amount) { id, #Name, { red, green, blue, alpha }, amount },
+#include "Material.def"
+#undef MATERIAL
+};
+
+const int materialCount = sizeof(materialInfo) / sizeof(materialInfo[0]);
+
+bool permutationsEnabled = true;
+
+// the material of a single id set, null for an id without a material
+const MaterialInfo *singleMaterial(Material::Set set)
+{
+  for (int i = 0; i < materialCount; ++i) {
+    if (Material::set(materialInfo[i].id) == set) {
+      return &materialInfo[i];
+    }
+  }
+  return 0;
+}
+
+// GLSL float literals need the decimal point
+QString glslFloat(GLfloat value)
+{
+  return QString::number(value, 'f', 6);
+}
+
+}
+
+Material::Set Material::permutation(Set materials)
+{
+  //a single bit set
+  if (permutationsEnabled && materials != 0 && (materials & (materials - 1)) == 0) {
+    return materials;
+  }
+  return Uber;
+}
+
+QByteArray Material::permutationDefines(Set permutation)
+{
+  if (permutation == Uber) {
+    return QByteArray("#define MATERIAL_TABLE\n#define MATERIAL_COUNT ") + QByteArray::number(int(Count)) + '\n';
+  }
+
+  const MaterialInfo *material = singleMaterial(permutation);
+  if (!material) {
+    return QByteArray();
+  }
+  const GLfloat *color = material->color;
+  return QString("#define MATERIAL_COLOR vec4(%1, %2, %3, %4)\n#define MATERIAL_AMOUNT %5\n")
+      .arg(glslFloat(color[0])).arg(glslFloat(color[1])).arg(glslFloat(color[2])).arg(glslFloat(color[3]))
+      .arg(glslFloat(material->amount)).toLatin1();
+}
+
+QString Material::permutationName(Set permutation)
+{
+  if (permutation == Uber) {
+    return QStringLiteral("uber");
+  }
+  const MaterialInfo *material = singleMaterial(permutation);
+  return material ? QString::fromLatin1(material->name).toLower() : QStringLiteral("none");
+}
+
+QString Material::glslShading()
+{
+  return QStringLiteral(
+      "#if defined(MATERIAL_TABLE)\n"
+      "flat in int materialID;\n"
+      "uniform vec4 materialColors[MATERIAL_COUNT];\n"
+      "uniform float materialAmounts[MATERIAL_COUNT];\n"
+      "vec4 shade(vec4 texel)\n"
+      "{\n"
+      "  int id = materialID & (MATERIAL_COUNT - 1);\n"
+      "  return mix(texel, materialColors[id], materialAmounts[id]);\n"
+      "}\n"
+      "#elif defined(MATERIAL_COLOR)\n"
+      "vec4 shade(vec4 texel) { return mix(texel, MATERIAL_COLOR, MATERIAL_AMOUNT); }\n"
+      "#else\n"
+      "vec4 shade(vec4 texel) { return texel; }\n"
+      "#endif\n");
+}
+
+void Material::setTableUniforms(QOpenGLShaderProgram *program)
+{
+  //ids without a material mix in nothing
+  QVector4D colors[Count];
+  GLfloat amounts[Count] = {};
+  for (int i = 0; i < materialCount; ++i) {
+    const MaterialInfo &material = materialInfo[i];
+    colors[material.id] = QVector4D(material.color[0], material.color[1], material.color[2], material.color[3]);
+    amounts[material.id] = material.amount;
+  }
+  program->setUniformValueArray("materialColors", colors, Count);
+  program->setUniformValueArray("materialAmounts", amounts, Count, 1);
+}
+
+bool Material::arePermutationsEnabled()
+{
+  return permutationsEnabled;
+}
+
+void Material::setPermutationsEnabled(bool enabled)
+{
+  permutationsEnabled = enabled;
+}
@@ -0,0 +1,96 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "ParameterLayout.h"
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram);
+
+// The material table, generated from Material.def. A parameter record selects a material with its
+// material id; the material tints the texture with mix(texel, color, amount). Ids without a
+// material draw the plain texture.
+//
+// The fragment shader is compiled in permutations, selected with preprocessor defines. A draw whose
+// records all use one material gets a program with that material compiled in as constants, so no
+// fragment branches on the id or reads a table. Draws mixing materials fall back to the uber
+// shader, which indexes uniform arrays holding the whole table with the id.
+namespace Material
+{
+  enum Id {
+    None = 0,
+#define MATERIAL(Name, id, red, green, blue, alpha, amount) Name = id,
+#include "Material.def"
+#undef MATERIAL
+  };
+
+  // ids are limited by the bits the compact encodings keep of the material field
+  enum { Count = 1 << ParameterLayout::fieldBits[ParameterLayout::Material] };
+
+  // a set of material ids, one bit per id
+  typedef quint32 Set;
+  inline Set set(int id) { return Set(1) << id; }
+  // the uber shader permutation
+  const Set Uber = ~Set(0);
+
+  // the permutation drawing records that use the materials in set: the set itself for a single
+  // material, Uber otherwise or if permutations are disabled
+  Set permutation(Set materials);
+  // the defines specialising glslShading() for a permutation, to follow the #version line
+  QByteArray permutationDefines(Set permutation);
+  QString permutationName(Set permutation);
+
+  // fragment shader function vec4 shade(vec4 texel) of every permutation; the uber shader reads
+  // "flat in int materialID"
+  QString glslShading();
+  // fills the table of the uber shader, called with its program bound
+  void setTableUniforms(QOpenGLShaderProgram *program);
+
+  // false draws everything with the uber shader
+  bool arePermutationsEnabled();
+  void setPermutationsEnabled(bool enabled);
+}
+
+#endif
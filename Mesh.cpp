@@ -0,0 +1,531 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QFile>
+#include <QHash>
+#include <QPair>
+
+#include <math.h>
+#include <string.h>
+
+#include "Mesh.h"
+#include "ParameterEncoding.h"
+
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+
+static const char *vertexFormatNameTable[] = { "float", "compact", "compact-half" };
+
+QString Mesh::_selectedPath;
+Mesh::VertexFormat Mesh::_selectedVertexFormat = Mesh::Float;
+
+//the weights of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static const float LastTriangleScore = 0.75f;
+static const float CacheDecayPower = 1.5f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+static float vertexScore(int cachePosition, int remainingTriangles, int cacheSize)
+{
+  if (remainingTriangles == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    //the vertices of the last triangle get a fixed score, so the next one does not just reuse two of them
+    if (cachePosition < 3) {
+      score = LastTriangleScore;
+    }
+    else {
+      score = powf(1.0f - float(cachePosition - 3) / (cacheSize - 3), CacheDecayPower);
+    }
+  }
+  //vertices with few triangles left are finished first, so they can leave the cache
+  return score + ValenceBoostScale * powf(float(remainingTriangles), -ValenceBoostPower);
+}
+
+Mesh::Mesh()
+{
+}
+
+Mesh Mesh::cube(float halfSize)
+{
+  static const int coords[6][4][3] = {
+    { { +1, -1, -1 }, { -1, -1, -1 }, { -1, +1, -1 }, { +1, +1, -1 } },
+    { { +1, +1, -1 }, { -1, +1, -1 }, { -1, +1, +1 }, { +1, +1, +1 } },
+    { { +1, -1, +1 }, { +1, -1, -1 }, { +1, +1, -1 }, { +1, +1, +1 } },
+    { { -1, -1, -1 }, { -1, -1, +1 }, { -1, +1, +1 }, { -1, +1, -1 } },
+    { { +1, -1, +1 }, { -1, -1, +1 }, { -1, -1, -1 }, { +1, -1, -1 } },
+    { { -1, -1, +1 }, { +1, -1, +1 }, { +1, +1, +1 }, { -1, +1, +1 } }
+  };
+
+  Mesh mesh;
+  mesh._name = QStringLiteral("cube");
+  for (int i = 0; i < 6; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      Vertex vertex;
+      vertex.position = halfSize * QVector3D(coords[i][j][0], coords[i][j][1], coords[i][j][2]);
+      vertex.texCoord = QVector2D(j == 0 || j == 3, j == 0 || j == 1);
+      mesh._vertices.append(vertex);
+    }
+    //the two triangles of the fan the side used to be drawn with, same winding
+    const quint32 first = i * 4;
+    mesh._indices << first << first + 1 << first + 2 << first << first + 2 << first + 3;
+  }
+  mesh.optimize();
+  return mesh;
+}
+
+//1-based, negative counts back from the last element read so far
+static int objIndex(const QByteArray &token, int count)
+{
+  bool ok = false;
+  const int index = token.toInt(&ok);
+  if (!ok || index == 0) {
+    return -1;
+  }
+  const int resolved = index > 0 ? index - 1 : count + index;
+  return resolved < count ? resolved : -1;
+}
+
+bool Mesh::loadObj(const QString &path, QString *error)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    *error = file.errorString();
+    return false;
+  }
+
+  QVector<QVector3D> positions;
+  QVector<QVector2D> texCoords;
+  QHash<QPair<int, int>, quint32> vertexIds;
+  QVector<Vertex> vertices;
+  QVector<quint32> indices;
+  int lineNumber = 0;
+  while (!file.atEnd()) {
+    const QByteArray line = file.readLine().simplified();
+    ++lineNumber;
+    if (line.isEmpty() || line.startsWith('#')) {
+      continue;
+    }
+
+    const QList<QByteArray> tokens = line.split(' ');
+    const QByteArray &keyword = tokens.first();
+    if (keyword == "v" && tokens.count() >= 4) {
+      positions.append(QVector3D(tokens[1].toFloat(), tokens[2].toFloat(), tokens[3].toFloat()));
+    }
+    else if (keyword == "vt" && tokens.count() >= 3) {
+      texCoords.append(QVector2D(tokens[1].toFloat(), tokens[2].toFloat()));
+    }
+    else if (keyword == "f" && tokens.count() >= 4) {
+      QVector<quint32> face;
+      for (int i = 1; i < tokens.count(); ++i) {
+        //v, v/vt, v//vn or v/vt/vn; normals are not used
+        const QList<QByteArray> parts = tokens[i].split('/');
+        const int position = objIndex(parts[0], positions.count());
+        const int texCoord = (parts.count() > 1 && !parts[1].isEmpty()) ? objIndex(parts[1], texCoords.count()) : -2;
+        if (position < 0 || texCoord == -1) {
+          *error = QString("invalid face index on line %1").arg(lineNumber);
+          return false;
+        }
+
+        const QPair<int, int> key(position, texCoord);
+        QHash<QPair<int, int>, quint32>::const_iterator it = vertexIds.constFind(key);
+        if (it == vertexIds.constEnd()) {
+          Vertex vertex;
+          vertex.position = positions[position];
+          vertex.texCoord = texCoord >= 0 ? texCoords[texCoord] : QVector2D(-1.0f, -1.0f);
+          it = vertexIds.insert(key, vertices.count());
+          vertices.append(vertex);
+        }
+        face.append(*it);
+      }
+      for (int i = 2; i < face.count(); ++i) {
+        indices << face[0] << face[i - 1] << face[i];
+      }
+    }
+    //groups, materials, normals and smoothing groups are ignored
+  }
+
+  if (indices.isEmpty()) {
+    *error = QStringLiteral("no faces");
+    return false;
+  }
+
+  _name = path;
+  _vertices = vertices;
+  _indices = indices;
+
+  if (texCoords.isEmpty()) {
+    QVector3D minimum = _vertices.first().position;
+    QVector3D maximum = minimum;
+    for (int i = 1; i < _vertices.count(); ++i) {
+      const QVector3D &p = _vertices[i].position;
+      minimum = QVector3D(qMin(minimum.x(), p.x()), qMin(minimum.y(), p.y()), qMin(minimum.z(), p.z()));
+      maximum = QVector3D(qMax(maximum.x(), p.x()), qMax(maximum.y(), p.y()), qMax(maximum.z(), p.z()));
+    }
+    const QVector3D size = maximum - minimum;
+    for (int i = 0; i < _vertices.count(); ++i) {
+      const QVector3D &p = _vertices[i].position;
+      _vertices[i].texCoord = QVector2D(size.x() > 0 ? (p.x() - minimum.x()) / size.x() : 0.0f,
+                                        size.y() > 0 ? (p.y() - minimum.y()) / size.y() : 0.0f);
+    }
+  }
+  return true;
+}
+
+void Mesh::fit(float halfSize)
+{
+  if (_vertices.isEmpty()) {
+    return;
+  }
+
+  QVector3D minimum = _vertices.first().position;
+  QVector3D maximum = minimum;
+  for (int i = 1; i < _vertices.count(); ++i) {
+    const QVector3D &p = _vertices[i].position;
+    minimum = QVector3D(qMin(minimum.x(), p.x()), qMin(minimum.y(), p.y()), qMin(minimum.z(), p.z()));
+    maximum = QVector3D(qMax(maximum.x(), p.x()), qMax(maximum.y(), p.y()), qMax(maximum.z(), p.z()));
+  }
+  const QVector3D center = (minimum + maximum) / 2.0f;
+  const QVector3D size = maximum - minimum;
+  const float largest = qMax(size.x(), qMax(size.y(), size.z()));
+  const float scale = largest > 0.0f ? 2.0f * halfSize / largest : 1.0f;
+  for (int i = 0; i < _vertices.count(); ++i) {
+    _vertices[i].position = (_vertices[i].position - center) * scale;
+  }
+}
+
+void Mesh::optimize(int cacheSize)
+{
+  const int triangleCount = _indices.count() / 3;
+  const int vertexCount = _vertices.count();
+  if (triangleCount == 0) {
+    return;
+  }
+  cacheSize = qMax(4, cacheSize);
+
+  //the triangles of every vertex; the ones not emitted yet are kept at the front of its list
+  QVector<int> remaining(vertexCount, 0);
+  for (int i = 0; i < _indices.count(); ++i) {
+    ++remaining[_indices[i]];
+  }
+  QVector<int> firstTriangle(vertexCount + 1, 0);
+  for (int v = 0; v < vertexCount; ++v) {
+    firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+  }
+  QVector<int> vertexTriangles(_indices.count());
+  QVector<int> filled(vertexCount, 0);
+  for (int t = 0; t < triangleCount; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      const quint32 v = _indices[t * 3 + k];
+      vertexTriangles[firstTriangle[v] + filled[v]++] = t;
+    }
+  }
+
+  QVector<int> cachePosition(vertexCount, -1);
+  QVector<float> score(vertexCount);
+  for (int v = 0; v < vertexCount; ++v) {
+    score[v] = vertexScore(-1, remaining[v], cacheSize);
+  }
+  QVector<float> triangleScore(triangleCount);
+  QVector<bool> emitted(triangleCount, false);
+  int best = 0;
+  for (int t = 0; t < triangleCount; ++t) {
+    triangleScore[t] = score[_indices[t * 3]] + score[_indices[t * 3 + 1]] + score[_indices[t * 3 + 2]];
+    if (triangleScore[t] > triangleScore[best]) {
+      best = t;
+    }
+  }
+
+  QVector<quint32> output;
+  output.reserve(_indices.count());
+  QVector<int> cache;
+  QVector<int> nextCache;
+  for (int emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+    if (best < 0) {
+      //no triangle touches the cache, start over from the best one left
+      for (int t = 0; t < triangleCount; ++t) {
+        if (!emitted[t] && (best < 0 || triangleScore[t] > triangleScore[best])) {
+          best = t;
+        }
+      }
+    }
+
+    emitted[best] = true;
+    const quint32 *corners = _indices.constData() + best * 3;
+    nextCache.clear();
+    for (int k = 0; k < 3; ++k) {
+      const quint32 v = corners[k];
+      output.append(v);
+      nextCache.append(v);
+      //move the triangle behind the ones still to be emitted
+      int *triangles = vertexTriangles.data() + firstTriangle[v];
+      for (int i = 0; i < remaining[v]; ++i) {
+        if (triangles[i] == best) {
+          qSwap(triangles[i], triangles[remaining[v] - 1]);
+          break;
+        }
+      }
+      --remaining[v];
+    }
+    for (int i = 0; i < cache.count(); ++i) {
+      if (!nextCache.contains(cache[i])) {
+        nextCache.append(cache[i]);
+      }
+    }
+
+    //rescore the vertices that moved in the cache or dropped out of it, and their triangles
+    best = -1;
+    for (int i = 0; i < nextCache.count(); ++i) {
+      const int v = nextCache[i];
+      cachePosition[v] = i < cacheSize ? i : -1;
+      const float newScore = vertexScore(cachePosition[v], remaining[v], cacheSize);
+      const float delta = newScore - score[v];
+      score[v] = newScore;
+      const int *triangles = vertexTriangles.constData() + firstTriangle[v];
+      for (int j = 0; j < remaining[v]; ++j) {
+        const int t = triangles[j];
+        triangleScore[t] += delta;
+        if (cachePosition[v] >= 0 && (best < 0 || triangleScore[t] > triangleScore[best])) {
+          best = t;
+        }
+      }
+    }
+    if (nextCache.count() > cacheSize) {
+      nextCache.resize(cacheSize);
+    }
+    qSwap(cache, nextCache);
+  }
+
+  //vertices in the order the triangles first use them, so the fetches walk the buffer forwards
+  QVector<int> remap(vertexCount, -1);
+  QVector<Vertex> vertices;
+  vertices.reserve(vertexCount);
+  for (int i = 0; i < output.count(); ++i) {
+    int &index = remap[output[i]];
+    if (index < 0) {
+      index = vertices.count();
+      vertices.append(_vertices[output[i]]);
+    }
+    output[i] = index;
+  }
+  _vertices = vertices;
+  _indices = output;
+}
+
+double Mesh::averageCacheMissRatio(int cacheSize) const
+{
+  if (_indices.isEmpty()) {
+    return 0.0;
+  }
+
+  //a vertex stays in a FIFO cache until cacheSize other vertices missed after it
+  QVector<qint64> missedAt(_vertices.count(), -qint64(cacheSize) - 1);
+  qint64 misses = 0;
+  for (int i = 0; i < _indices.count(); ++i) {
+    qint64 &stamp = missedAt[_indices[i]];
+    if (misses - stamp > cacheSize) {
+      ++misses;
+      stamp = misses;
+    }
+  }
+  return double(misses) / (_indices.count() / 3);
+}
+
+float Mesh::extent() const
+{
+  float largest = 0.0f;
+  for (int i = 0; i < _vertices.count(); ++i) {
+    const QVector3D &p = _vertices[i].position;
+    largest = qMax(largest, qMax(qAbs(p.x()), qMax(qAbs(p.y()), qAbs(p.z()))));
+  }
+  return largest > 0.0f ? largest : 1.0f;
+}
+
+float Mesh::positionScale(VertexFormat format) const
+{
+  return format == Float ? 1.0f : extent();
+}
+
+int Mesh::vertexStride(VertexFormat format)
+{
+  return format == Float ? 5 * sizeof(GLfloat) : 4 * sizeof(GLshort) + 4;
+}
+
+Mesh::Attribute Mesh::positionAttribute(VertexFormat format)
+{
+  Attribute attribute;
+  attribute.type = format == Float ? GL_FLOAT : GL_SHORT;
+  attribute.tupleSize = format == Float ? 3 : 4;
+  attribute.normalized = format != Float;
+  attribute.offset = 0;
+  return attribute;
+}
+
+Mesh::Attribute Mesh::texCoordAttribute(VertexFormat format)
+{
+  Attribute attribute;
+  attribute.tupleSize = 2;
+  switch (format) {
+  case Compact:
+    attribute.type = GL_UNSIGNED_BYTE;
+    attribute.normalized = true;
+    attribute.offset = 4 * sizeof(GLshort);
+    break;
+  case CompactHalf:
+    attribute.type = GL_HALF_FLOAT;
+    attribute.normalized = false;
+    attribute.offset = 4 * sizeof(GLshort);
+    break;
+  default:
+    attribute.type = GL_FLOAT;
+    attribute.normalized = false;
+    attribute.offset = 3 * sizeof(GLfloat);
+    break;
+  }
+  return attribute;
+}
+
+static GLshort toNormalizedShort(float value)
+{
+  return GLshort(qRound(qBound(-1.0f, value, 1.0f) * 32767.0f));
+}
+
+static GLubyte toNormalizedByte(float value)
+{
+  return GLubyte(qRound(qBound(0.0f, value, 1.0f) * 255.0f));
+}
+
+QByteArray Mesh::vertexData(VertexFormat format) const
+{
+  const int stride = vertexStride(format);
+  QByteArray data(_vertices.count() * stride, 0);
+  char *out = data.data();
+  const float scale = 1.0f / positionScale(format);
+  for (int i = 0; i < _vertices.count(); ++i, out += stride) {
+    const Vertex &vertex = _vertices[i];
+    if (format == Float) {
+      const GLfloat values[5] = { vertex.position.x(), vertex.position.y(), vertex.position.z(),
+                                  vertex.texCoord.x(), vertex.texCoord.y() };
+      memcpy(out, values, sizeof(values));
+      continue;
+    }
+
+    const GLshort position[4] = { toNormalizedShort(vertex.position.x() * scale), toNormalizedShort(vertex.position.y() * scale),
+                                  toNormalizedShort(vertex.position.z() * scale), 0 };
+    memcpy(out, position, sizeof(position));
+    if (format == Compact) {
+      const GLubyte texCoord[2] = { toNormalizedByte(vertex.texCoord.x()), toNormalizedByte(vertex.texCoord.y()) };
+      memcpy(out + sizeof(position), texCoord, sizeof(texCoord));
+    }
+    else {
+      const quint16 texCoord[2] = { ParameterEncoding::toHalf(vertex.texCoord.x()), ParameterEncoding::toHalf(vertex.texCoord.y()) };
+      memcpy(out + sizeof(position), texCoord, sizeof(texCoord));
+    }
+  }
+  return data;
+}
+
+GLenum Mesh::indexType() const
+{
+  return _vertices.count() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+QByteArray Mesh::indexData() const
+{
+  if (indexType() == GL_UNSIGNED_INT) {
+    return QByteArray(reinterpret_cast<const char *>(_indices.constData()), _indices.count() * sizeof(quint32));
+  }
+
+  QByteArray data(_indices.count() * sizeof(quint16), Qt::Uninitialized);
+  quint16 *out = reinterpret_cast<quint16 *>(data.data());
+  for (int i = 0; i < _indices.count(); ++i) {
+    out[i] = quint16(_indices[i]);
+  }
+  return data;
+}
+
+QString Mesh::selectedPath()
+{
+  return _selectedPath;
+}
+
+void Mesh::setSelectedPath(const QString &path)
+{
+  _selectedPath = path;
+}
+
+Mesh::VertexFormat Mesh::selectedVertexFormat()
+{
+  return _selectedVertexFormat;
+}
+
+void Mesh::setSelectedVertexFormat(VertexFormat format)
+{
+  _selectedVertexFormat = format;
+}
+
+QString Mesh::vertexFormatName(VertexFormat format)
+{
+  return QString::fromLatin1(vertexFormatNameTable[format]);
+}
+
+bool Mesh::vertexFormatFromName(const QString &name, VertexFormat *format)
+{
+  for (int i = 0; i < VertexFormatCount; ++i) {
+    if (name == QLatin1String(vertexFormatNameTable[i])) {
+      *format = static_cast<VertexFormat>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+QStringList Mesh::vertexFormatNames()
+{
+  QStringList names;
+  for (int i = 0; i < VertexFormatCount; ++i) {
+    names << QString::fromLatin1(vertexFormatNameTable[i]);
+  }
+  return names;
+}
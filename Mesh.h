@@ -0,0 +1,142 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+#include <qopengl.h>
+
+// Indexed triangle mesh with interleaved positions and texture coordinates, drawn with a single
+// glDrawElements. It is either the demo cube or loaded from a Wavefront OBJ file; both have their
+// triangles reordered for the post-transform vertex cache (Forsyth's algorithm) and their vertices
+// renumbered in the order the triangles first use them.
+//
+// vertexData() packs the vertices in one of the VertexFormats:
+// * Float - 3 floats position, 2 floats texture coordinate, 20 bytes
+// * Compact - 4 normalized shorts position, 2 normalized unsigned bytes texture coordinate and
+//   2 bytes padding, 12 bytes. Texture coordinates are clamped to [0, 1].
+// * CompactHalf - 4 normalized shorts position, 2 half float texture coordinates, 12 bytes
+// The shader multiplies the decoded position by positionScale(), which maps the short range back
+// to the extent of the mesh.
+class Mesh
+{
+public:
+  enum VertexFormat {
+    Float,
+    Compact,
+    CompactHalf,
+    VertexFormatCount
+  };
+
+  enum { DefaultCacheSize = 32 };
+
+  struct Vertex
+  {
+    QVector3D position;
+    QVector2D texCoord;
+  };
+
+  struct Attribute
+  {
+    GLenum type;
+    int tupleSize;
+    bool normalized;
+    int offset;
+  };
+
+  Mesh();
+
+  // the demo cube, one quad with its own texture coordinates per side
+  static Mesh cube(float halfSize);
+  // false, with a message in error, if the file cannot be read or holds no triangles. Polygons
+  // are triangulated as fans; without texture coordinates the XY extent is mapped to [0, 1].
+  bool loadObj(const QString &path, QString *error);
+  // centers the mesh and scales it uniformly to fit into [-halfSize, halfSize] on every axis
+  void fit(float halfSize);
+  // reorders the triangles for a vertex cache of cacheSize entries, then the vertices by first use
+  void optimize(int cacheSize = DefaultCacheSize);
+  // transformed vertices per triangle with a FIFO cache of cacheSize entries, 0.5 at best
+  double averageCacheMissRatio(int cacheSize = DefaultCacheSize) const;
+
+  QString name() const { return _name; }
+  int vertexCount() const { return _vertices.count(); }
+  int indexCount() const { return _indices.count(); }
+  const QVector<Vertex> &vertices() const { return _vertices; }
+  const QVector<quint32> &indices() const { return _indices; }
+
+  QByteArray vertexData(VertexFormat format) const;
+  // as GL_UNSIGNED_SHORT if every index fits, GL_UNSIGNED_INT otherwise
+  QByteArray indexData() const;
+  GLenum indexType() const;
+  float positionScale(VertexFormat format) const;
+
+  static int vertexStride(VertexFormat format);
+  static Attribute positionAttribute(VertexFormat format);
+  static Attribute texCoordAttribute(VertexFormat format);
+
+  // the OBJ file drawn instead of the cube, empty for the cube
+  static QString selectedPath();
+  static void setSelectedPath(const QString &path);
+  static VertexFormat selectedVertexFormat();
+  static void setSelectedVertexFormat(VertexFormat format);
+
+  static QString vertexFormatName(VertexFormat format);
+  static bool vertexFormatFromName(const QString &name, VertexFormat *format);
+  static QStringList vertexFormatNames();
+
+private:
+  // largest absolute coordinate, the scale of the normalized shorts
+  float extent() const;
+
+  QString _name;
+  QVector<Vertex> _vertices;
+  QVector<quint32> _indices;
+
+  static QString _selectedPath;
+  static VertexFormat _selectedVertexFormat;
+};
+
+#endif
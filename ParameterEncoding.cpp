@@ -0,0 +1,343 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QGenericMatrix>
+#include <QList>
+#include <QQuaternion>
+#include <QVector3D>
+
+#include <math.h>
+#include <string.h>
+
+#include "ParameterEncoding.h"
+
+ParameterEncoding::Encoding ParameterEncoding::_selectedEncoding = ParameterEncoding::Full;
+
+static const char *encodingNameTable[] = { "full", "affine", "quaternion", "half" };
+
+static const char *glslDecoders =
+    "mat4 affineMatrix(vec4 row0, vec4 row1, vec4 row2) { return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0))); }\n"
+    "mat4 quaternionMatrix(vec4 q, vec3 t)\n"
+    "{\n"
+    "  //q is scaled by the square root of the uniform scale, so the rotation comes out scaled\n"
+    "  float ww = q.w*q.w, xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;\n"
+    "  return mat4(ww+xx-yy-zz, 2.0*(q.x*q.y+q.w*q.z), 2.0*(q.x*q.z-q.w*q.y), 0.0,\n"
+    "              2.0*(q.x*q.y-q.w*q.z), ww-xx+yy-zz, 2.0*(q.y*q.z+q.w*q.x), 0.0,\n"
+    "              2.0*(q.x*q.z+q.w*q.y), 2.0*(q.y*q.z-q.w*q.x), ww-xx-yy+zz, 0.0,\n"
+    "              t, 1.0);\n"
+    "}\n"
+    "int unpackBits(float packed, int shift, int bits) { return (int(packed) >> shift) & ((1 << bits) - 1); }\n";
+
+quint16 ParameterEncoding::toHalf(float value)
+{
+  quint32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const quint16 sign = (bits >> 16) & 0x8000;
+  const int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+  quint32 mantissa = bits & 0x7fffff;
+  if (exponent <= 0) {
+    return sign;
+  }
+  if (exponent >= 31) {
+    return sign | 0x7c00;
+  }
+  mantissa += 0x1000;
+  if (mantissa & 0x800000) {
+    return exponent + 1 >= 31 ? (sign | 0x7c00) : quint16(sign | ((exponent + 1) << 10));
+  }
+  return sign | (exponent << 10) | (mantissa >> 13);
+}
+
+ParameterEncoding::ParameterEncoding(Encoding encoding)
+  : _encoding(encoding),
+    _floatTexels(ParameterLayout::FloatTexels),
+    _intTexels(ParameterLayout::IntTexels)
+{
+  memset(_placements, 0, sizeof(_placements));
+  if (_encoding == Full) {
+    return;
+  }
+
+  //texel aligned fields first, whatever they leave free is used by the scalars
+  int next = 0;
+  QList<int> spares;
+  for (int i = 0; i < ParameterLayout::FieldCount; ++i) {
+    const ParameterLayout::Type type = ParameterLayout::fieldTypes[i];
+    if (type == ParameterLayout::Mat4 || type == ParameterLayout::Vec4) {
+      _placements[i].component = ParameterLayout::alignUp(next, 4);
+      if (type == ParameterLayout::Vec4) {
+        next = _placements[i].component + 4;
+      }
+      else if (_encoding == Quaternion) {
+        //quaternion + translation.xyz, the w of the translation texel is free
+        next = _placements[i].component + 8;
+        spares << next - 1;
+      }
+      else {
+        next = _placements[i].component + 12;
+      }
+    }
+  }
+  for (int i = 0; i < ParameterLayout::FieldCount; ++i) {
+    if (ParameterLayout::fieldTypes[i] == ParameterLayout::Float) {
+      _placements[i].component = spares.isEmpty() ? next++ : spares.takeFirst();
+    }
+  }
+  //integers are exact up to 2^24 in a float and 2^11 in a half float
+  const int capacity = isHalfFloat() ? 11 : 24;
+  int packed = -1;
+  int used = capacity;
+  for (int i = 0; i < ParameterLayout::FieldCount; ++i) {
+    if (ParameterLayout::fieldTypes[i] == ParameterLayout::Int) {
+      const int bits = ParameterLayout::fieldBits[i];
+      Q_ASSERT_X(bits > 0 && bits <= capacity, "ParameterEncoding", "bad bit count in ParameterLayout.def");
+      if (used + bits > capacity) {
+        packed = spares.isEmpty() ? next++ : spares.takeFirst();
+        used = 0;
+      }
+      _placements[i].component = packed;
+      _placements[i].shift = used;
+      used += bits;
+    }
+  }
+  Q_ASSERT(next <= MaxComponents);
+
+  //the iMX6 needs at least two members in the VertexData struct
+  _floatTexels = qMax(2, ParameterLayout::alignUp(next, 4) / 4);
+  _intTexels = 0;
+}
+
+void ParameterEncoding::encodeRecord(const GLfloat *record, GLfloat *components) const
+{
+  memset(components, 0, _floatTexels * 4 * sizeof(GLfloat));
+  for (int i = 0; i < ParameterLayout::FieldCount; ++i) {
+    const GLfloat *field = record + ParameterLayout::offset(static_cast<ParameterLayout::Field>(i));
+    GLfloat *component = components + _placements[i].component;
+
+    switch (ParameterLayout::fieldTypes[i]) {
+    case ParameterLayout::Mat4:
+      if (_encoding == Quaternion) {
+        const float scale = QVector3D(field[0], field[1], field[2]).length();
+        QMatrix3x3 rotation;
+        for (int row = 0; row < 3; ++row) {
+          for (int column = 0; column < 3; ++column) {
+            rotation(row, column) = scale > 0.0f ? field[column * 4 + row] / scale : 0.0f;
+          }
+        }
+        const QQuaternion q = QQuaternion::fromRotationMatrix(rotation).normalized() * sqrtf(scale);
+        component[0] = q.x();
+        component[1] = q.y();
+        component[2] = q.z();
+        component[3] = q.scalar();
+        component[4] = field[12];
+        component[5] = field[13];
+        component[6] = field[14];
+      }
+      else {
+        //the record is column-major, the affine rows are stored
+        for (int row = 0; row < 3; ++row) {
+          for (int column = 0; column < 4; ++column) {
+            component[row * 4 + column] = field[column * 4 + row];
+          }
+        }
+      }
+      break;
+    case ParameterLayout::Vec4:
+      memcpy(component, field, 4 * sizeof(GLfloat));
+      break;
+    case ParameterLayout::Float:
+      *component = *field;
+      break;
+    case ParameterLayout::Int: {
+      GLint value;
+      memcpy(&value, field, sizeof(GLint));
+      value &= (1 << ParameterLayout::fieldBits[i]) - 1;
+      *component += GLfloat(value << _placements[i].shift);
+      break;
+    }
+    }
+  }
+}
+
+void ParameterEncoding::encode(const GLfloat *records, int count, void *slots) const
+{
+  if (_encoding == Full) {
+    memcpy(slots, records, count * slotBytes());
+    return;
+  }
+  encodeSection(records, count, slots, false);
+}
+
+void ParameterEncoding::encodeSection(const GLfloat *records, int count, void *texels, bool ints) const
+{
+  if (_encoding == Full) {
+    const int offset = ints ? ParameterLayout::FloatComponents : 0;
+    const int components = ints ? ParameterLayout::IntComponents : ParameterLayout::FloatComponents;
+    GLfloat *out = static_cast<GLfloat *>(texels);
+    for (int i = 0; i < count; ++i) {
+      memcpy(out + i * components, records + i * ParameterLayout::SlotComponents + offset, components * sizeof(GLfloat));
+    }
+    return;
+  }
+  if (ints) {
+    return;
+  }
+
+  const int components = _floatTexels * 4;
+  GLfloat encoded[MaxComponents];
+  for (int i = 0; i < count; ++i) {
+    const GLfloat *record = records + i * ParameterLayout::SlotComponents;
+    if (isHalfFloat()) {
+      encodeRecord(record, encoded);
+      quint16 *out = static_cast<quint16 *>(texels) + i * components;
+      for (int c = 0; c < components; ++c) {
+        out[c] = toHalf(encoded[c]);
+      }
+    }
+    else {
+      encodeRecord(record, static_cast<GLfloat *>(texels) + i * components);
+    }
+  }
+}
+
+QString ParameterEncoding::glslConstants() const
+{
+  return QString(
+      "const int floatTexels = %1;\n"
+      "const int intTexels = %2;\n"
+      "const int slotTexels = %3;\n").arg(_floatTexels).arg(_intTexels).arg(slotTexels());
+}
+
+QString ParameterEncoding::glslTexelAccessors(const QString &floatTexel, const QString &intTexel) const
+{
+  if (_encoding == Full) {
+    return ParameterLayout::glslTexelAccessors(floatTexel, intTexel);
+  }
+
+  static const char swizzle[] = "xyzw";
+  QString source = QLatin1String(glslDecoders);
+  for (int i = 0; i < ParameterLayout::FieldCount; ++i) {
+    const ParameterLayout::Type type = ParameterLayout::fieldTypes[i];
+    const int first = _placements[i].component / 4;
+    const QString component = floatTexel.arg(first) + QLatin1Char('.') + QLatin1Char(swizzle[_placements[i].component % 4]);
+
+    QString value;
+    switch (type) {
+    case ParameterLayout::Mat4:
+      if (_encoding == Quaternion) {
+        value = QString("quaternionMatrix(%1, %2.xyz)").arg(floatTexel.arg(first)).arg(floatTexel.arg(first + 1));
+      }
+      else {
+        value = QString("affineMatrix(%1, %2, %3)").arg(floatTexel.arg(first)).arg(floatTexel.arg(first + 1)).arg(floatTexel.arg(first + 2));
+      }
+      break;
+    case ParameterLayout::Vec4:
+      value = floatTexel.arg(first);
+      break;
+    case ParameterLayout::Float:
+      value = component;
+      break;
+    case ParameterLayout::Int:
+      value = QString("unpackBits(%1, %2, %3)").arg(component).arg(_placements[i].shift).arg(ParameterLayout::fieldBits[i]);
+      break;
+    }
+    source += QString("%1 %2(int index) { return %3; }\n")
+        .arg(ParameterLayout::glslType(type))
+        .arg(ParameterLayout::accessor(static_cast<ParameterLayout::Field>(i)))
+        .arg(value);
+  }
+  return source;
+}
+
+QString ParameterEncoding::glslStruct() const
+{
+  if (_encoding == Full) {
+    return ParameterLayout::glslStruct();
+  }
+
+  QString source = QStringLiteral("struct VertexData {\n");
+  for (int i = 0; i < _floatTexels; ++i) {
+    source += QString("  vec4 texel%1;\n").arg(i);
+  }
+  return source + QStringLiteral("};\n");
+}
+
+QString ParameterEncoding::glslStructAccessors(const QString &array) const
+{
+  if (_encoding == Full) {
+    return ParameterLayout::glslStructAccessors(array);
+  }
+  return glslTexelAccessors(array + QStringLiteral("[index].texel%1"), QString());
+}
+
+ParameterEncoding::Encoding ParameterEncoding::selectedEncoding()
+{
+  return _selectedEncoding;
+}
+
+void ParameterEncoding::setSelectedEncoding(Encoding encoding)
+{
+  _selectedEncoding = encoding;
+}
+
+QString ParameterEncoding::encodingName(Encoding encoding)
+{
+  return QString::fromLatin1(encodingNameTable[encoding]);
+}
+
+bool ParameterEncoding::encodingFromName(const QString &name, Encoding *encoding)
+{
+  for (int i = 0; i < EncodingCount; ++i) {
+    if (name.compare(QLatin1String(encodingNameTable[i]), Qt::CaseInsensitive) == 0) {
+      *encoding = static_cast<Encoding>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+QStringList ParameterEncoding::encodingNames()
+{
+  QStringList names;
+  for (int i = 0; i < EncodingCount; ++i) {
+    names << QString::fromLatin1(encodingNameTable[i]);
+  }
+  return names;
+}
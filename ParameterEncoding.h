@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PARAMETERENCODING_H
+#define PARAMETERENCODING_H
+
+#include <QString>
+#include <QStringList>
+#include <qopengl.h>
+
+#include "ParameterLayout.h"
+
+// How the ParameterLayout records are stored on the GPU. A slot is a run of vec4 texels: the float
+// texels followed by the int texels. The full encoding is the record itself (80 bytes with the
+// current fields); the compact encodings only have float texels and need no int fetch:
+//   affine     - mat4 fields as 3x4 row-major affine matrices
+//   quaternion - mat4 fields as a quaternion scaled by the square root of a uniform scale plus a
+//                translation; only valid for rotation, uniform scale and translation
+//   half       - as affine, stored as half floats (RGBA16F), texture backends only
+// Float fields take a free component, int fields are quantised to the bits given in
+// ParameterLayout.def and packed into the spare components as exact integers.
+class ParameterEncoding
+{
+public:
+  enum Encoding {
+    Full,
+    Affine,
+    Quaternion,
+    Half,
+    EncodingCount
+  };
+
+  explicit ParameterEncoding(Encoding encoding = Full);
+
+  Encoding encoding() const { return _encoding; }
+  QString name() const { return encodingName(_encoding); }
+  bool isHalfFloat() const { return _encoding == Half; }
+
+  int floatTexels() const { return _floatTexels; }
+  int intTexels() const { return _intTexels; }
+  int slotTexels() const { return _floatTexels + _intTexels; }
+  // bytes of the float section, the int section and a whole slot
+  int floatBytes() const { return _floatTexels * (isHalfFloat() ? 8 : 16); }
+  int intBytes() const { return _intTexels * 16; }
+  int slotBytes() const { return floatBytes() + intBytes(); }
+
+  // count records to count slots
+  void encode(const GLfloat *records, int count, void *slots) const;
+  // only the float or the int section of count records, one after the other
+  void encodeSection(const GLfloat *records, int count, void *texels, bool ints) const;
+
+  // const int floatTexels, intTexels and slotTexels
+  QString glslConstants() const;
+  // as ParameterLayout::glslTexelAccessors, decoding the encoded texels
+  QString glslTexelAccessors(const QString &floatTexel, const QString &intTexel) const;
+  // struct VertexData of a slot and accessors reading array[index], for the buffer backends
+  QString glslStruct() const;
+  QString glslStructAccessors(const QString &array) const;
+
+  static Encoding selectedEncoding();
+  static void setSelectedEncoding(Encoding encoding);
+
+  static QString encodingName(Encoding encoding);
+  static bool encodingFromName(const QString &name, Encoding *encoding);
+  static QStringList encodingNames();
+
+  // IEEE 754 binary16, rounded to nearest; values below its normal range flush to zero
+  static quint16 toHalf(float value);
+
+private:
+  enum { MaxComponents = 64 };
+
+  // where a field lives in the float section: its first component, and for packed int fields
+  // the bit offset within that component
+  struct Placement
+  {
+    int component;
+    int shift;
+  };
+
+  void encodeRecord(const GLfloat *record, GLfloat *components) const;
+
+  Encoding _encoding;
+  int _floatTexels;
+  int _intTexels;
+  Placement _placements[ParameterLayout::FieldCount];
+
+  static Encoding _selectedEncoding;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QStringList>
+
+#include "ParameterLayout.h"
+
+namespace {
+
+struct FieldInfo
+{
+  const char *member;
+  const char *accessor;
+};
+
+const FieldInfo fieldInfo[] = {
+#define PARAMETER_FIELD(Name, member, type, bits, accessor) { #member, #accessor },
+#include "ParameterLayout.def"
+#undef PARAMETER_FIELD
+};
+
+// the fields of one section in offset order
+QList<int> sectionFields(bool ints)
+{
+  QList<int> fields;
+  for (int i = 0; i < ParameterLayout::FieldCount; ++i) {
+    if (ParameterLayout::isInt(ParameterLayout::fieldTypes[i]) == ints) {
+      fields << i;
+    }
+  }
+  return fields;
+}
+
+// members of one section, with explicit padding where std140 would not add it by itself
+QString sectionMembers(bool ints, int sectionSize, int *padCount)
+{
+  QString source;
+  int end = 0;
+  foreach (int i, sectionFields(ints)) {
+    const ParameterLayout::Type type = ParameterLayout::fieldTypes[i];
+    end = ParameterLayout::alignUp(end, ParameterLayout::alignment(type));
+    source += QString("  %1 %2;\n").arg(ParameterLayout::glslType(type)).arg(fieldInfo[i].member);
+    end += ParameterLayout::components(type);
+  }
+  for (; end < sectionSize; ++end) {
+    source += QString("  %1 dummy%2;\n").arg(ints ? "int" : "float").arg((*padCount)++);
+  }
+  return source;
+}
+
+}
+
+const char *ParameterLayout::glslType(Type type)
+{
+  switch (type) {
+  case Float:
+    return "float";
+  case Vec4:
+    return "vec4";
+  case Mat4:
+    return "mat4";
+  case Int:
+  default:
+    return "int";
+  }
+}
+
+const char *ParameterLayout::accessor(Field field)
+{
+  return fieldInfo[field].accessor;
+}
+
+QString ParameterLayout::glslStruct()
+{
+  //the padding also keeps the struct at two members or more, the iMX6 needs that to avoid graphical corruption
+  int padCount = 0;
+  return QStringLiteral("struct VertexData {\n")
+      + sectionMembers(false, FloatComponents, &padCount)
+      + sectionMembers(true, IntComponents, &padCount)
+      + QStringLiteral("};\n");
+}
+
+QString ParameterLayout::glslStructAccessors(const QString &array)
+{
+  QString source;
+  for (int i = 0; i < FieldCount; ++i) {
+    source += QString("%1 %2(int index) { return %3[index].%4; }\n")
+        .arg(glslType(fieldTypes[i])).arg(fieldInfo[i].accessor).arg(array).arg(fieldInfo[i].member);
+  }
+  return source;
+}
+
+QString ParameterLayout::glslTexelAccessors(const QString &floatTexel, const QString &intTexel)
+{
+  static const char swizzle[] = "xyzw";
+  QString source;
+  for (int i = 0; i < FieldCount; ++i) {
+    const Type type = fieldTypes[i];
+    const int sectionOffset = offset(static_cast<Field>(i)) - (isInt(type) ? FloatComponents : 0);
+    const QString &texel = isInt(type) ? intTexel : floatTexel;
+    const int first = sectionOffset / 4;
+
+    QString value;
+    switch (type) {
+    case Mat4:
+      value = QString("mat4(%1, %2, %3, %4)").arg(texel.arg(first)).arg(texel.arg(first + 1))
+          .arg(texel.arg(first + 2)).arg(texel.arg(first + 3));
+      break;
+    case Vec4:
+      value = texel.arg(first);
+      break;
+    case Float:
+    case Int:
+      value = texel.arg(first) + QLatin1Char('.') + QLatin1Char(swizzle[sectionOffset % 4]);
+      break;
+    }
+    source += QString("%1 %2(int index) { return %3; }\n").arg(glslType(type)).arg(fieldInfo[i].accessor).arg(value);
+  }
+  return source;
+}
+
+QString ParameterLayout::glslCurrentAccessors()
+{
+  QString source;
+  for (int i = 0; i < FieldCount; ++i) {
+    source += QString("%1 %2(void) { return %2(getRotationIndex()); }\n")
+        .arg(glslType(fieldTypes[i])).arg(fieldInfo[i].accessor);
+  }
+  return source;
+}
@@ -0,0 +1,171 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PARAMETERLAYOUT_H
+#define PARAMETERLAYOUT_H
+
+#include <QMatrix4x4>
+#include <QString>
+#include <QVector4D>
+#include <qopengl.h>
+
+#include <string.h>
+
+// The per-object shader parameter record, generated from the field list in ParameterLayout.def.
+//
+// A record is an array of 32 bit components: the float fields come first, then the int fields,
+// each section padded to whole vec4 texels. Within a section vec4 and mat4 fields are aligned to
+// 4 components, as in std140, so a record is a valid std140 and std430 struct and can also be
+// fetched texel by texel from RGBA32F and RGBA32I textures. Offsets and sizes are compile time
+// constants; the GLSL declarations and accessors of every backend are generated from the same list.
+// This is the layout the renderer writes and the full encoding uploads; ParameterEncoding derives
+// the compact ones from it.
+namespace ParameterLayout
+{
+  enum Type { Float, Vec4, Mat4, Int };
+
+  enum Field {
+#define PARAMETER_FIELD(Name, member, type, bits, accessor) Name,
+#include "ParameterLayout.def"
+#undef PARAMETER_FIELD
+    FieldCount
+  };
+
+  constexpr Type fieldTypes[] = {
+#define PARAMETER_FIELD(Name, member, type, bits, accessor) type,
+#include "ParameterLayout.def"
+#undef PARAMETER_FIELD
+  };
+
+  constexpr int fieldBits[] = {
+#define PARAMETER_FIELD(Name, member, type, bits, accessor) bits,
+#include "ParameterLayout.def"
+#undef PARAMETER_FIELD
+  };
+
+  constexpr bool isInt(Type type) { return type == Int; }
+  constexpr int components(Type type) { return type == Mat4 ? 16 : type == Vec4 ? 4 : 1; }
+  constexpr int alignment(Type type) { return components(type) == 1 ? 1 : 4; }
+  constexpr int alignUp(int offset, int alignment) { return (offset + alignment - 1) / alignment * alignment; }
+
+  // end of the fields before field that belong to the int or float section, relative to the section
+  constexpr int sectionEnd(bool ints, int field)
+  {
+    return field == 0 ? 0
+        : isInt(fieldTypes[field - 1]) != ints ? sectionEnd(ints, field - 1)
+        : alignUp(sectionEnd(ints, field - 1), alignment(fieldTypes[field - 1])) + components(fieldTypes[field - 1]);
+  }
+
+  enum {
+    FloatComponents = alignUp(sectionEnd(false, FieldCount), 4),
+    IntComponents = alignUp(sectionEnd(true, FieldCount), 4),
+    SlotComponents = FloatComponents + IntComponents,
+    FloatTexels = FloatComponents / 4,
+    IntTexels = IntComponents / 4,
+    SlotTexels = SlotComponents / 4
+  };
+
+  // offset of a field from the start of the record, in components
+  constexpr int offset(Field field)
+  {
+    return isInt(fieldTypes[field])
+        ? FloatComponents + alignUp(sectionEnd(true, field), alignment(fieldTypes[field]))
+        : alignUp(sectionEnd(false, field), alignment(fieldTypes[field]));
+  }
+
+  template <Type T> struct FieldTraits;
+
+  template <> struct FieldTraits<Float>
+  {
+    typedef GLfloat ValueType;
+    static void write(GLfloat *component, GLfloat value) { *component = value; }
+  };
+
+  template <> struct FieldTraits<Vec4>
+  {
+    typedef QVector4D ValueType;
+    static void write(GLfloat *component, const QVector4D &value)
+    {
+      component[0] = value.x();
+      component[1] = value.y();
+      component[2] = value.z();
+      component[3] = value.w();
+    }
+  };
+
+  template <> struct FieldTraits<Mat4>
+  {
+    typedef QMatrix4x4 ValueType;
+    static void write(GLfloat *component, const QMatrix4x4 &value) { memcpy(component, value.constData(), 16 * sizeof(GLfloat)); }
+  };
+
+  //int components are stored bit for bit in the float array
+  template <> struct FieldTraits<Int>
+  {
+    typedef GLint ValueType;
+    static void write(GLfloat *component, GLint value) { memcpy(component, &value, sizeof(GLint)); }
+  };
+
+  // typed setters, setName(record, value)
+#define PARAMETER_FIELD(Name, member, type, bits, accessor) \
+  inline void set##Name(GLfloat *record, const FieldTraits<type>::ValueType &value) \
+  { FieldTraits<type>::write(record + offset(Name), value); }
+#include "ParameterLayout.def"
+#undef PARAMETER_FIELD
+
+  // zeroes the padding so that records can be compared and hashed
+  inline void clear(GLfloat *record) { memset(record, 0, SlotComponents * sizeof(GLfloat)); }
+
+  // GLSL type and accessor function name of a field
+  const char *glslType(Type type);
+  const char *accessor(Field field);
+
+  // struct VertexData with the fields in record order, including the padding
+  QString glslStruct();
+  // accessor(int index) functions returning array[index].member
+  QString glslStructAccessors(const QString &array);
+  // accessor(int index) functions assembling each field from texels. floatTexel and intTexel are
+  // GLSL expressions of index and %1, the texel within the float or int section of the record.
+  QString glslTexelAccessors(const QString &floatTexel, const QString &intTexel);
+  // accessor(void) overloads reading the record of getRotationIndex()
+  QString glslCurrentAccessors();
+}
+
+#endif
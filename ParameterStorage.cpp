@@ -0,0 +1,972 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QSurfaceFormat>
+#include <QDebug>
+
+#include <string.h>
+
+#include "GLStateCache.h"
+#include "ParameterStorage.h"
+
+#ifndef GL_TEXTURE_BUFFER
+#define GL_TEXTURE_BUFFER 0x8C2A
+#endif
+#ifndef GL_MAX_TEXTURE_BUFFER_SIZE
+#define GL_MAX_TEXTURE_BUFFER_SIZE 0x8C2B
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS
+#define GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS 0x90D6
+#endif
+#ifndef GL_MAX_SHADER_STORAGE_BLOCK_SIZE
+#define GL_MAX_SHADER_STORAGE_BLOCK_SIZE 0x90DE
+#endif
+#ifndef GL_MAX_VERTEX_UNIFORM_COMPONENTS
+#define GL_MAX_VERTEX_UNIFORM_COMPONENTS 0x8B4A
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+
+#ifdef USE_UBO
+ParameterStorage::Backend ParameterStorage::_selectedBackend = ParameterStorage::Ubo;
+#else
+ParameterStorage::Backend ParameterStorage::_selectedBackend = ParameterStorage::Texture;
+#endif
+
+//unchanged slots between two changed runs that are sent anyway, one upload call costs more
+static const int MaxUploadGap = 4;
+
+static const char *backendNameTable[] = { "uniform", "ubo", "texture", "tbo", "ssbo", "ubo-ring" };
+
+ParameterStorage::ParameterStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : _f(QOpenGLContext::currentContext()->extraFunctions()),
+    _state(GLStateCache::current()),
+    _program(0),
+    _capacity(qMax(1, capacity)),
+    _encoding(encoding),
+    _uploadedBytes(0),
+    _allocatedBytes(0)
+{
+}
+
+ParameterStorage::~ParameterStorage()
+{
+}
+
+int ParameterStorage::bindBatch(int /* batch */)
+{
+  return _capacity;
+}
+
+void ParameterStorage::limitCapacity(int maxCapacity, const char *limit)
+{
+  if (_capacity > maxCapacity) {
+    qWarning() << name() << "storage can hold" << maxCapacity << "slots because of" << limit
+               << "," << _capacity << "were requested";
+    _capacity = qMax(1, maxCapacity);
+  }
+}
+
+GLint ParameterStorage::integerv(GLenum pname) const
+{
+  GLint value = 0;
+  _f->glGetIntegerv(pname, &value);
+  return value;
+}
+
+bool ParameterStorage::isChanged(int slot, const GLfloat *record) const
+{
+  return !_currentValid.testBit(slot)
+      || memcmp(_current.constData() + slot * SlotFloats, record, SlotFloats * sizeof(GLfloat)) != 0;
+}
+
+int ParameterStorage::uploadChanged(int first, int count, const GLfloat *data)
+{
+  //sized on first use, initialize() may have lowered the capacity
+  if (_currentValid.size() != _capacity) {
+    _current.resize(_capacity * SlotFloats);
+    _currentValid = QBitArray(_capacity);
+  }
+
+  const int end = first + count;
+  int sent = 0;
+  int slot = first;
+  while (slot < end) {
+    while (slot < end && !isChanged(slot, data + (slot - first) * SlotFloats)) {
+      ++slot;
+    }
+    if (slot == end) {
+      break;
+    }
+
+    int runEnd = slot + 1;
+    for (int i = runEnd; i < end && i - runEnd < MaxUploadGap; ++i) {
+      if (isChanged(i, data + (i - first) * SlotFloats)) {
+        runEnd = i + 1;
+      }
+    }
+
+    const GLfloat *records = data + (slot - first) * SlotFloats;
+    upload(slot, runEnd - slot, records);
+    memcpy(_current.data() + slot * SlotFloats, records, (runEnd - slot) * SlotFloats * sizeof(GLfloat));
+    _currentValid.fill(true, slot, runEnd);
+    sent += runEnd - slot;
+    slot = runEnd;
+  }
+  return sent;
+}
+
+const GLubyte *ParameterStorage::encodeSlots(const GLfloat *data, int count)
+{
+  if (_encoding.encoding() == ParameterEncoding::Full) {
+    return reinterpret_cast<const GLubyte *>(data);
+  }
+  if (_staging.size() < count * _encoding.slotBytes()) {
+    _staging.resize(count * _encoding.slotBytes());
+  }
+  _encoding.encode(data, count, _staging.data());
+  return _staging.constData();
+}
+
+QByteArray ParameterStorage::glslVersion() const
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if (context->isOpenGLES()) {
+    switch (backend()) {
+    case Ssbo:
+      return QByteArrayLiteral("#version 310 es\n");
+    case TextureBuffer:
+      if (context->format().version() >= qMakePair(3, 2)) {
+        return QByteArrayLiteral("#version 320 es\n");
+      }
+      if (context->hasExtension(QByteArrayLiteral("GL_EXT_texture_buffer"))) {
+        return QByteArrayLiteral("#version 310 es\n#extension GL_EXT_texture_buffer : require\n");
+      }
+      return QByteArrayLiteral("#version 310 es\n#extension GL_OES_texture_buffer : require\n");
+    default:
+      return QByteArrayLiteral("#version 300 es\n");
+    }
+  }
+  if (backend() == Ssbo) {
+    return QByteArrayLiteral("#version 430\n");
+  }
+  return QByteArrayLiteral("#version 150\n");
+}
+
+ParameterStorage *ParameterStorage::create(Backend backend, int capacity, ParameterEncoding::Encoding encoding)
+{
+  if (!isSupported(backend, QOpenGLContext::currentContext())) {
+    qWarning() << "Shader parameter storage" << backendName(backend)
+               << "is not supported by this context, falling back to" << backendName(Texture);
+    backend = Texture;
+  }
+  if (!supportsEncoding(backend, encoding)) {
+    qWarning() << "Parameter encoding" << ParameterEncoding::encodingName(encoding) << "is not supported by"
+               << backendName(backend) << "storage, falling back to" << ParameterEncoding::encodingName(ParameterEncoding::Affine);
+    encoding = ParameterEncoding::Affine;
+  }
+
+  switch (backend) {
+  case Uniform:
+    return new UniformStorage(capacity, encoding);
+  case Ubo:
+    return new UboStorage(capacity, encoding);
+  case TextureBuffer:
+    return new TextureBufferStorage(capacity, encoding);
+  case Ssbo:
+    return new SsboStorage(capacity, encoding);
+  case UboRing:
+    return new UboRingStorage(capacity, encoding);
+  case Texture:
+  default:
+    return new TextureStorage(capacity, encoding);
+  }
+}
+
+bool ParameterStorage::isSupported(Backend backend, QOpenGLContext *context)
+{
+  const QPair<int, int> version = context->format().version();
+  const bool es = context->isOpenGLES();
+
+  switch (backend) {
+  case TextureBuffer:
+    if (es) {
+      return version >= qMakePair(3, 2)
+          || (version >= qMakePair(3, 1)
+              && (context->hasExtension(QByteArrayLiteral("GL_EXT_texture_buffer"))
+                  || context->hasExtension(QByteArrayLiteral("GL_OES_texture_buffer"))));
+    }
+    return version >= qMakePair(3, 1);
+  case Ssbo: {
+    if (version < (es ? qMakePair(3, 1) : qMakePair(4, 3))) {
+      return false;
+    }
+    //SSBOs are only guaranteed in the fragment and compute stages on GLES 3.1
+    GLint maxVertexBlocks = 0;
+    context->functions()->glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &maxVertexBlocks);
+    return maxVertexBlocks > 0;
+  }
+  default:
+    return true;
+  }
+}
+
+bool ParameterStorage::supportsEncoding(Backend backend, ParameterEncoding::Encoding encoding)
+{
+  //only textures convert half floats for the shader, uniforms and blocks have no 16 bit float type
+  return encoding != ParameterEncoding::Half || backend == Texture || backend == TextureBuffer;
+}
+
+ParameterStorage::Backend ParameterStorage::selectedBackend()
+{
+  return _selectedBackend;
+}
+
+void ParameterStorage::setSelectedBackend(Backend backend)
+{
+  _selectedBackend = backend;
+}
+
+void ParameterStorage::requestFormat(Backend backend, QSurfaceFormat &format)
+{
+  if (QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGL) {
+    if (backend == Ssbo) {
+      format.setVersion(4, 3);
+    }
+    else {
+      format.setVersion(3, 2);
+    }
+  }
+  else {
+    if (backend == Ssbo) {
+      format.setVersion(3, 1);
+    }
+    else if (backend == TextureBuffer) {
+      format.setVersion(3, 2);
+    }
+    else {
+      format.setVersion(3, 0);
+    }
+  }
+}
+
+QString ParameterStorage::backendName(Backend backend)
+{
+  return QString::fromLatin1(backendNameTable[backend]);
+}
+
+bool ParameterStorage::backendFromName(const QString &name, Backend *backend)
+{
+  for (int i = 0; i < BackendCount; ++i) {
+    if (name.compare(QLatin1String(backendNameTable[i]), Qt::CaseInsensitive) == 0) {
+      *backend = static_cast<Backend>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+QStringList ParameterStorage::backendNames()
+{
+  QStringList names;
+  for (int i = 0; i < BackendCount; ++i) {
+    names << QString::fromLatin1(backendNameTable[i]);
+  }
+  return names;
+}
+
+//
+// uniforms
+//
+
+UniformStorage::UniformStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : ParameterStorage(capacity, encoding),
+    _batchSize(0),
+    _floatLocation(-1),
+    _intLocation(-1),
+    _boundBatch(-1)
+{
+  //a slot takes one vector per texel; keep a few vectors for the projection and other uniforms
+  GLint maxVectors;
+  if (QOpenGLContext::currentContext()->isOpenGLES()) {
+    maxVectors = integerv(GL_MAX_VERTEX_UNIFORM_VECTORS);
+  }
+  else {
+    maxVectors = integerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS) / 4;
+  }
+  _batchSize = qBound(1, (maxVectors - 8) / _encoding.slotTexels(), _capacity);
+  _shadow.resize(_capacity * SlotFloats);
+  _floats.resize(_batchSize * _encoding.floatTexels() * 4);
+  _ints.resize(_batchSize * _encoding.intTexels() * 4);
+}
+
+QString UniformStorage::vertexShaderSource() const
+{
+  QString source = _encoding.glslConstants();
+  if (_encoding.floatTexels() > 0) {
+    source += QString("uniform vec4 u_floats[floatTexels*%1];\n").arg(_batchSize);
+  }
+  if (_encoding.intTexels() > 0) {
+    source += QString("uniform ivec4 u_ints[intTexels*%1];\n").arg(_batchSize);
+  }
+  return source + "\n" + _encoding.glslTexelAccessors("u_floats[floatTexels*index+%1]", "u_ints[intTexels*index+%1]");
+}
+
+bool UniformStorage::initialize(QOpenGLShaderProgram *program)
+{
+  qDebug("Uniform-based shader parameter mechanism");
+  initializeProgram(program);
+  setProgram(program);
+  return true;
+}
+
+bool UniformStorage::initializeProgram(QOpenGLShaderProgram *program)
+{
+  _locations.insert(program, qMakePair(program->uniformLocation("u_floats"), program->uniformLocation("u_ints")));
+  return true;
+}
+
+void UniformStorage::setProgram(QOpenGLShaderProgram *program)
+{
+  if (program == _program) {
+    return;
+  }
+  _program = program;
+  const QPair<GLint, GLint> locations = _locations.value(program, qMakePair(-1, -1));
+  _floatLocation = locations.first;
+  _intLocation = locations.second;
+  //the batch is sent again, to the uniforms of this program
+  _boundBatch = -1;
+}
+
+void UniformStorage::upload(int first, int count, const GLfloat *data)
+{
+  memcpy(&_shadow[first * SlotFloats], data, count * SlotFloats * sizeof(GLfloat));
+  _boundBatch = -1;
+}
+
+int UniformStorage::bindBatch(int batch)
+{
+  const int first = batch * _batchSize;
+  const int count = qMin(_batchSize, _capacity - first);
+  if (batch == _boundBatch) {
+    return count;
+  }
+
+  const GLfloat *records = &_shadow[first * SlotFloats];
+  if (_encoding.floatTexels() > 0) {
+    _encoding.encodeSection(records, count, _floats.data(), false);
+    _f->glUniform4fv(_floatLocation, count * _encoding.floatTexels(), _floats.constData());
+  }
+  if (_encoding.intTexels() > 0) {
+    _encoding.encodeSection(records, count, _ints.data(), true);
+    _f->glUniform4iv(_intLocation, count * _encoding.intTexels(), _ints.constData());
+  }
+  _uploadedBytes += count * _encoding.slotBytes();
+  _boundBatch = batch;
+  return count;
+}
+
+void UniformStorage::endFrame()
+{
+  //the uniforms belong to the program, which other renderers in the share group also use
+  _boundBatch = -1;
+}
+
+void UniformStorage::destroy()
+{
+}
+
+//
+// uniform buffer object
+//
+
+UboStorage::UboStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : ParameterStorage(capacity, encoding),
+    _uboId(0),
+    _uboIndex(0),
+    _uboSize(0),
+    _chunkSlots(0),
+    _chunkStride(0)
+{
+  _chunkSlots = qBound(1, integerv(GL_MAX_UNIFORM_BLOCK_SIZE) / _encoding.slotBytes(), _capacity);
+  //every chunk has to start at a multiple of the offset alignment to be usable with glBindBufferRange
+  const GLint alignment = qMax(1, integerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT));
+  _chunkStride = ((_chunkSlots * _encoding.slotBytes() + alignment - 1) / alignment) * alignment;
+}
+
+QString UboStorage::vertexShaderSource() const
+{
+  return _encoding.glslStruct()
+      + QString(
+        "layout(std140) uniform u_VertexData {\n"
+        "  VertexData vData[%1];\n"
+        "};\n"
+        "\n").arg(_chunkSlots)
+      + _encoding.glslStructAccessors("vData");
+}
+
+bool UboStorage::initializeBlock(QOpenGLShaderProgram *program)
+{
+  _program = program;
+  _uboIndex = _f->glGetUniformBlockIndex(program->programId(), "u_VertexData");
+  if (_uboIndex == GL_INVALID_INDEX) {
+    qWarning("u_VertexData uniform block index could not be determined.");
+    return false;
+  }
+  _f->glGetActiveUniformBlockiv(program->programId(), _uboIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &_uboSize);
+  if (batchCount() > 1) {
+    qDebug("%d slots split into %d uniform block chunks of %d slots", _capacity, batchCount(), _chunkSlots);
+  }
+  return true;
+}
+
+GLintptr UboStorage::slotOffset(int slot) const
+{
+  return (slot / _chunkSlots) * _chunkStride + (slot % _chunkSlots) * _encoding.slotBytes();
+}
+
+GLsizeiptr UboStorage::bufferSize() const
+{
+  return (batchCount() - 1) * _chunkStride + _uboSize;
+}
+
+bool UboStorage::initialize(QOpenGLShaderProgram *program)
+{
+  qDebug("UBO-based shader parameter mechanism");
+  //use UBO as a shader parameter mechanism
+  if (!initializeBlock(program)) {
+    return false;
+  }
+
+  //create UBO data store
+  _f->glGenBuffers(1, &_uboId);
+  _f->glBindBuffer(GL_UNIFORM_BUFFER, _uboId);
+  _f->glBufferData(GL_UNIFORM_BUFFER, bufferSize(), NULL, GL_DYNAMIC_DRAW);
+  _f->glBindBufferBase(GL_UNIFORM_BUFFER, _uboIndex, _uboId);
+  _allocatedBytes = bufferSize();
+  return true;
+}
+
+bool UboStorage::initializeProgram(QOpenGLShaderProgram *program)
+{
+  //the block of every other program reads the binding point of the first one
+  const GLuint index = _f->glGetUniformBlockIndex(program->programId(), "u_VertexData");
+  if (index == GL_INVALID_INDEX) {
+    qWarning("u_VertexData uniform block index could not be determined.");
+    return false;
+  }
+  _f->glUniformBlockBinding(program->programId(), index, _uboIndex);
+  return true;
+}
+
+void UboStorage::upload(int first, int count, const GLfloat *data)
+{
+  const GLubyte *slots = encodeSlots(data, count);
+  _uploadedBytes += count * _encoding.slotBytes();
+  _state->bindBuffer(GL_UNIFORM_BUFFER, _uboId);
+  //one glBufferSubData per chunk touched by the range
+  while (count > 0) {
+    const int run = qMin(count, _chunkSlots - first % _chunkSlots);
+    _f->glBufferSubData(GL_UNIFORM_BUFFER, slotOffset(first), run * _encoding.slotBytes(), slots);
+    first += run;
+    count -= run;
+    slots += run * _encoding.slotBytes();
+  }
+}
+
+int UboStorage::bindBatch(int batch)
+{
+  _state->bindBufferRange(GL_UNIFORM_BUFFER, _uboIndex, _uboId, batch * _chunkStride, _uboSize);
+  return qMin(_chunkSlots, _capacity - batch * _chunkSlots);
+}
+
+void UboStorage::destroy()
+{
+  _f->glDeleteBuffers(1, &_uboId);
+  _uboId = 0;
+}
+
+//
+// ring of uniform buffer slices
+//
+
+UboRingStorage::UboRingStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : UboStorage(capacity, encoding),
+    _sliceSize(0),
+    _slice(0),
+    _dirty(false),
+    _frameOpen(false),
+    _persistentData(0),
+    _fenceWaits(0)
+{
+  for (int i = 0; i < RingSize; ++i) {
+    _fences[i] = 0;
+  }
+}
+
+bool UboRingStorage::initialize(QOpenGLShaderProgram *program)
+{
+  qDebug("UBO ring-based shader parameter mechanism");
+  if (!initializeBlock(program)) {
+    return false;
+  }
+
+  //a slice holds every chunk, slices are aligned like chunks
+  const GLint alignment = qMax(1, integerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT));
+  _sliceSize = ((bufferSize() + alignment - 1) / alignment) * alignment;
+  _shadow.fill(0, bufferSize());
+
+  _f->glGenBuffers(1, &_uboId);
+  _f->glBindBuffer(GL_UNIFORM_BUFFER, _uboId);
+
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  BufferStorageProc bufferStorage = 0;
+  if (context->isOpenGLES()) {
+    if (context->hasExtension(QByteArrayLiteral("GL_EXT_buffer_storage"))) {
+      bufferStorage = reinterpret_cast<BufferStorageProc>(context->getProcAddress("glBufferStorageEXT"));
+    }
+  }
+  else if (context->format().version() >= qMakePair(4, 4) || context->hasExtension(QByteArrayLiteral("GL_ARB_buffer_storage"))) {
+    bufferStorage = reinterpret_cast<BufferStorageProc>(context->getProcAddress("glBufferStorage"));
+  }
+
+  if (bufferStorage) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    bufferStorage(GL_UNIFORM_BUFFER, _sliceSize * RingSize, NULL, flags);
+    _persistentData = static_cast<GLubyte *>(_f->glMapBufferRange(GL_UNIFORM_BUFFER, 0, _sliceSize * RingSize, flags));
+  }
+  if (_persistentData) {
+    qDebug("Persistently mapped %d x %d byte UBO ring", int(RingSize), int(_sliceSize));
+  }
+  else {
+    //no immutable storage or the persistent mapping failed, map each slice unsynchronized
+    if (bufferStorage) {
+      _f->glDeleteBuffers(1, &_uboId);
+      _f->glGenBuffers(1, &_uboId);
+      _f->glBindBuffer(GL_UNIFORM_BUFFER, _uboId);
+    }
+    _f->glBufferData(GL_UNIFORM_BUFFER, _sliceSize * RingSize, NULL, GL_DYNAMIC_DRAW);
+    qDebug("Unsynchronized mapped %d x %d byte UBO ring", int(RingSize), int(_sliceSize));
+  }
+  _f->glBindBufferRange(GL_UNIFORM_BUFFER, _uboIndex, _uboId, 0, _uboSize);
+  _allocatedBytes = _sliceSize * RingSize;
+  return true;
+}
+
+void UboRingStorage::waitForSlice(int slice)
+{
+  GLsync fence = _fences[slice];
+  if (!fence) {
+    return;
+  }
+  GLenum status = _f->glClientWaitSync(fence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    //the GPU is still reading this slice, nothing left to do but wait
+    ++_fenceWaits;
+    do {
+      status = _f->glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+  }
+  _f->glDeleteSync(fence);
+  _fences[slice] = 0;
+}
+
+void UboRingStorage::upload(int first, int count, const GLfloat *data)
+{
+  const GLubyte *slots = encodeSlots(data, count);
+  while (count > 0) {
+    const int run = qMin(count, _chunkSlots - first % _chunkSlots);
+    memcpy(_shadow.data() + slotOffset(first), slots, run * _encoding.slotBytes());
+    first += run;
+    count -= run;
+    slots += run * _encoding.slotBytes();
+  }
+  _dirty = true;
+}
+
+void UboRingStorage::writeSlice()
+{
+  _slice = (_slice + 1) % RingSize;
+  waitForSlice(_slice);
+  _frameOpen = true;
+  _dirty = false;
+
+  const GLintptr offset = _slice * _sliceSize;
+  _uploadedBytes += _shadow.size();
+  if (_persistentData) {
+    memcpy(_persistentData + offset, _shadow.constData(), _shadow.size());
+  }
+  else {
+    _state->bindBuffer(GL_UNIFORM_BUFFER, _uboId);
+    void *slice = _f->glMapBufferRange(GL_UNIFORM_BUFFER, offset, _shadow.size(),
+                                       GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (slice) {
+      memcpy(slice, _shadow.constData(), _shadow.size());
+      _f->glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+  }
+}
+
+int UboRingStorage::bindBatch(int batch)
+{
+  //the new parameters go to the next slice on the first draw of a frame
+  if (_dirty) {
+    writeSlice();
+  }
+  //a frame that uploads nothing still reads the slice, so it is fenced as well
+  _frameOpen = true;
+  _state->bindBufferRange(GL_UNIFORM_BUFFER, _uboIndex, _uboId, _slice * _sliceSize + batch * _chunkStride, _uboSize);
+  return qMin(_chunkSlots, _capacity - batch * _chunkSlots);
+}
+
+void UboRingStorage::endFrame()
+{
+  if (_frameOpen) {
+    //the latest frame reading the slice is the one its next writer has to wait for
+    if (_fences[_slice]) {
+      _f->glDeleteSync(_fences[_slice]);
+    }
+    _fences[_slice] = _f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _frameOpen = false;
+  }
+}
+
+void UboRingStorage::destroy()
+{
+  qDebug() << "UBO ring waited on a fence" << _fenceWaits << "times";
+  for (int i = 0; i < RingSize; ++i) {
+    if (_fences[i]) {
+      _f->glDeleteSync(_fences[i]);
+      _fences[i] = 0;
+    }
+  }
+  if (_persistentData) {
+    _f->glBindBuffer(GL_UNIFORM_BUFFER, _uboId);
+    _f->glUnmapBuffer(GL_UNIFORM_BUFFER);
+    _persistentData = 0;
+  }
+  UboStorage::destroy();
+}
+
+//
+// 2D storage textures
+//
+
+TextureStorage::TextureStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : ParameterStorage(capacity, encoding),
+    _slotsPerRow(0),
+    _rows(0),
+    _floatStorageTexId(0),
+    _intStorageTexId(0)
+{
+  //wrap into more rows once a row of the wider texture would exceed the maximum texture size
+  const GLint maxSize = integerv(GL_MAX_TEXTURE_SIZE);
+  const int maxTexels = qMax(_encoding.floatTexels(), _encoding.intTexels());
+  limitCapacity((maxSize / maxTexels) * maxSize, "GL_MAX_TEXTURE_SIZE");
+  _slotsPerRow = qMin(_capacity, maxSize / maxTexels);
+  _rows = (_capacity + _slotsPerRow - 1) / _slotsPerRow;
+  //sized for 32 bit texels, half float texels need half of it
+  _floatTexels.resize(_slotsPerRow * _encoding.floatTexels() * 4);
+  _intTexels.resize(_slotsPerRow * _encoding.intTexels() * 4);
+}
+
+QString TextureStorage::vertexShaderSource() const
+{
+  return QString(
+      "#ifdef GL_ES\n"
+      "precision mediump isampler2D;\n"
+      "#endif\n"
+      "uniform sampler2D floatSampler;\n"
+      "uniform isampler2D intSampler;\n"
+      "const int slotsPerRow = %1;\n").arg(_slotsPerRow)
+      + _encoding.glslConstants()
+      + QStringLiteral(
+        "\n"
+        "ivec2 getTexel(int index, int texels, int k) { return ivec2(k+texels*(index%slotsPerRow), index/slotsPerRow); }\n")
+      + _encoding.glslTexelAccessors("texelFetch(floatSampler, getTexel(index,floatTexels,%1), 0)",
+                                     "texelFetch(intSampler, getTexel(index,intTexels,%1), 0)");
+}
+
+bool TextureStorage::initialize(QOpenGLShaderProgram *program)
+{
+  qDebug("Texture-based shader parameter mechanism");
+  _program = program;
+  if (_rows > 1) {
+    qDebug("%d slots laid out in %d rows of %d slots", _capacity, _rows, _slotsPerRow);
+  }
+  //use texture as shader parameter mechanism
+  //create texture for float data
+  _f->glGenTextures(1, &_floatStorageTexId);
+  _f->glBindTexture(GL_TEXTURE_2D, _floatStorageTexId);
+  //we're using this texture as storage, so do not want mipmapping
+  _f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  _f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  //create the storage
+  _f->glTexImage2D(GL_TEXTURE_2D, 0, _encoding.isHalfFloat() ? GL_RGBA16F : GL_RGBA32F, qMax(1, _encoding.floatTexels() * _slotsPerRow), _rows,
+                   0, GL_RGBA, _encoding.isHalfFloat() ? GL_HALF_FLOAT : GL_FLOAT, NULL);
+
+  //create texture for int data
+  _f->glGenTextures(1, &_intStorageTexId);
+  _f->glBindTexture(GL_TEXTURE_2D, _intStorageTexId);
+  _f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  _f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  _f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32I, qMax(1, _encoding.intTexels() * _slotsPerRow), _rows, 0, GL_RGBA_INTEGER, GL_INT, NULL);
+  _allocatedBytes = qint64(qMax(1, _encoding.floatTexels() * _slotsPerRow)) * _rows * (_encoding.isHalfFloat() ? 8 : 16)
+                    + qint64(qMax(1, _encoding.intTexels() * _slotsPerRow)) * _rows * 16;
+
+  return initializeProgram(program);
+}
+
+bool TextureStorage::initializeProgram(QOpenGLShaderProgram *program)
+{
+  //the units never change, so the samplers are set once with the program bound
+  program->setUniformValue("floatSampler", 1);
+  program->setUniformValue("intSampler", 2);
+  return true;
+}
+
+void TextureStorage::upload(int first, int count, const GLfloat *data)
+{
+  //one glTexSubImage2D per row and texture touched by the range
+  while (count > 0) {
+    const int column = first % _slotsPerRow;
+    const int row = first / _slotsPerRow;
+    const int run = qMin(count, _slotsPerRow - column);
+    //update float texture
+    if (_encoding.floatTexels() > 0) {
+      _encoding.encodeSection(data, run, _floatTexels.data(), false);
+      _state->activeTexture(GL_TEXTURE1);
+      _state->bindTexture(GL_TEXTURE1, GL_TEXTURE_2D, _floatStorageTexId);
+      _f->glTexSubImage2D(GL_TEXTURE_2D, 0, _encoding.floatTexels() * column, row, _encoding.floatTexels() * run, 1,
+                          GL_RGBA, _encoding.isHalfFloat() ? GL_HALF_FLOAT : GL_FLOAT, _floatTexels.constData());
+    }
+    //update int texture
+    if (_encoding.intTexels() > 0) {
+      _encoding.encodeSection(data, run, _intTexels.data(), true);
+      _state->activeTexture(GL_TEXTURE2);
+      _state->bindTexture(GL_TEXTURE2, GL_TEXTURE_2D, _intStorageTexId);
+      _f->glTexSubImage2D(GL_TEXTURE_2D, 0, _encoding.intTexels() * column, row, _encoding.intTexels() * run, 1,
+                          GL_RGBA_INTEGER, GL_INT, _intTexels.constData());
+    }
+    _uploadedBytes += run * _encoding.slotBytes();
+    first += run;
+    count -= run;
+    data += run * SlotFloats;
+  }
+}
+
+int TextureStorage::bindBatch(int /* batch */)
+{
+  _state->bindTexture(GL_TEXTURE1, GL_TEXTURE_2D, _floatStorageTexId);
+  _state->bindTexture(GL_TEXTURE2, GL_TEXTURE_2D, _intStorageTexId);
+  return _capacity;
+}
+
+void TextureStorage::destroy()
+{
+  _f->glDeleteTextures(1, &_floatStorageTexId);
+  _f->glDeleteTextures(1, &_intStorageTexId);
+  _floatStorageTexId = _intStorageTexId = 0;
+}
+
+//
+// buffer textures
+//
+
+TextureBufferStorage::TextureBufferStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : ParameterStorage(capacity, encoding),
+    _glTexBuffer(0),
+    _tboId(0),
+    _floatStorageTexId(0),
+    _intStorageTexId(0)
+{
+  limitCapacity(integerv(GL_MAX_TEXTURE_BUFFER_SIZE) / _encoding.slotTexels(), "GL_MAX_TEXTURE_BUFFER_SIZE");
+}
+
+QString TextureBufferStorage::vertexShaderSource() const
+{
+  //both views see whole slots, the int section starts after the float texels; the half encoding
+  //has no int section, so the two views never disagree about the texel size
+  return QStringLiteral(
+      "#ifdef GL_ES\n"
+      "precision mediump samplerBuffer;\n"
+      "precision mediump isamplerBuffer;\n"
+      "#endif\n"
+      "uniform samplerBuffer floatSampler;\n"
+      "uniform isamplerBuffer intSampler;\n")
+      + _encoding.glslConstants()
+      + QStringLiteral("\n")
+      + _encoding.glslTexelAccessors("texelFetch(floatSampler, slotTexels*index+%1)",
+                                     "texelFetch(intSampler, slotTexels*index+floatTexels+%1)");
+}
+
+bool TextureBufferStorage::initialize(QOpenGLShaderProgram *program)
+{
+  qDebug("Texture buffer-based shader parameter mechanism");
+  _program = program;
+
+  //glTexBuffer is core in GL 3.1 / GLES 3.2 but not exposed through QOpenGLExtraFunctions
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  _glTexBuffer = reinterpret_cast<TexBufferProc>(context->getProcAddress("glTexBuffer"));
+  if (!_glTexBuffer) {
+    _glTexBuffer = reinterpret_cast<TexBufferProc>(context->getProcAddress("glTexBufferEXT"));
+  }
+  if (!_glTexBuffer) {
+    _glTexBuffer = reinterpret_cast<TexBufferProc>(context->getProcAddress("glTexBufferOES"));
+  }
+  if (!_glTexBuffer) {
+    qWarning("glTexBuffer could not be resolved.");
+    return false;
+  }
+
+  //one buffer holds the parameter slots, the float and int textures are two views of it
+  _f->glGenBuffers(1, &_tboId);
+  _f->glBindBuffer(GL_TEXTURE_BUFFER, _tboId);
+  _f->glBufferData(GL_TEXTURE_BUFFER, _capacity * _encoding.slotBytes(), NULL, GL_DYNAMIC_DRAW);
+  _allocatedBytes = _capacity * _encoding.slotBytes();
+
+  _f->glGenTextures(1, &_floatStorageTexId);
+  _f->glBindTexture(GL_TEXTURE_BUFFER, _floatStorageTexId);
+  _glTexBuffer(GL_TEXTURE_BUFFER, _encoding.isHalfFloat() ? GL_RGBA16F : GL_RGBA32F, _tboId);
+
+  _f->glGenTextures(1, &_intStorageTexId);
+  _f->glBindTexture(GL_TEXTURE_BUFFER, _intStorageTexId);
+  _glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, _tboId);
+  return initializeProgram(program);
+}
+
+bool TextureBufferStorage::initializeProgram(QOpenGLShaderProgram *program)
+{
+  program->setUniformValue("floatSampler", 1);
+  program->setUniformValue("intSampler", 2);
+  return true;
+}
+
+void TextureBufferStorage::upload(int first, int count, const GLfloat *data)
+{
+  const GLubyte *slots = encodeSlots(data, count);
+  _uploadedBytes += count * _encoding.slotBytes();
+  _state->bindBuffer(GL_TEXTURE_BUFFER, _tboId);
+  _f->glBufferSubData(GL_TEXTURE_BUFFER, first * _encoding.slotBytes(), count * _encoding.slotBytes(), slots);
+}
+
+int TextureBufferStorage::bindBatch(int /* batch */)
+{
+  _state->bindTexture(GL_TEXTURE1, GL_TEXTURE_BUFFER, _floatStorageTexId);
+  _state->bindTexture(GL_TEXTURE2, GL_TEXTURE_BUFFER, _intStorageTexId);
+  return _capacity;
+}
+
+void TextureBufferStorage::destroy()
+{
+  _f->glDeleteTextures(1, &_floatStorageTexId);
+  _f->glDeleteTextures(1, &_intStorageTexId);
+  _f->glDeleteBuffers(1, &_tboId);
+  _floatStorageTexId = _intStorageTexId = _tboId = 0;
+}
+
+//
+// shader storage buffer object
+//
+
+SsboStorage::SsboStorage(int capacity, ParameterEncoding::Encoding encoding)
+  : ParameterStorage(capacity, encoding),
+    _ssboId(0)
+{
+  limitCapacity(integerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE) / _encoding.slotBytes(), "GL_MAX_SHADER_STORAGE_BLOCK_SIZE");
+}
+
+QString SsboStorage::vertexShaderSource() const
+{
+  return _encoding.glslStruct()
+      + QStringLiteral(
+        "layout(std430, binding = 0) readonly buffer VertexDataBlock {\n"
+        "  VertexData vData[];\n"
+        "};\n"
+        "\n")
+      + _encoding.glslStructAccessors("vData");
+}
+
+bool SsboStorage::initialize(QOpenGLShaderProgram *program)
+{
+  qDebug("SSBO-based shader parameter mechanism");
+  _program = program;
+  _f->glGenBuffers(1, &_ssboId);
+  _f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, _ssboId);
+  _f->glBufferData(GL_SHADER_STORAGE_BUFFER, _capacity * _encoding.slotBytes(), NULL, GL_DYNAMIC_DRAW);
+  _allocatedBytes = _capacity * _encoding.slotBytes();
+  return true;
+}
+
+void SsboStorage::upload(int first, int count, const GLfloat *data)
+{
+  const GLubyte *slots = encodeSlots(data, count);
+  _uploadedBytes += count * _encoding.slotBytes();
+  _state->bindBuffer(GL_SHADER_STORAGE_BUFFER, _ssboId);
+  _f->glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * _encoding.slotBytes(), count * _encoding.slotBytes(), slots);
+}
+
+int SsboStorage::bindBatch(int /* batch */)
+{
+  _state->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _ssboId);
+  return _capacity;
+}
+
+void SsboStorage::destroy()
+{
+  _f->glDeleteBuffers(1, &_ssboId);
+  _ssboId = 0;
+}
@@ -0,0 +1,336 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PARAMETERSTORAGE_H
+#define PARAMETERSTORAGE_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QOpenGLExtraFunctions>
+
+#include "ParameterEncoding.h"
+#include "ParameterLayout.h"
+
+class GLStateCache;
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext);
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram);
+QT_FORWARD_DECLARE_CLASS(QSurfaceFormat);
+
+// Storage mechanism for the per-object shader parameters, one ParameterLayout record per slot,
+// stored on the GPU in the ParameterEncoding given to create(). Each backend supplies the GLSL
+// accessors of the record fields (getRotationMatrix(int), getMaterialId(int), ...) and knows how
+// to get parameter slots from the CPU to the GPU.
+//
+// A storage holds capacity() slots. Backends whose shader-visible array is limited in size
+// (uniform arrays, uniform blocks) split the slots into batches; the shader index is relative
+// to the batch made current with bindBatch().
+//
+// Several programs can read one storage, such as the material permutations of a renderer. Each
+// one is set up once with initializeProgram() and selected with setProgram() before drawing.
+class ParameterStorage
+{
+public:
+  enum Backend {
+    Uniform,
+    Ubo,
+    Texture,
+    TextureBuffer,
+    Ssbo,
+    UboRing,
+    BackendCount
+  };
+
+  // number of parameter slots of the single cube scene and size of a record in 32 bit components
+  enum { SlotCount = 2, SlotFloats = ParameterLayout::SlotComponents };
+
+  virtual ~ParameterStorage();
+
+  virtual Backend backend() const = 0;
+  QString name() const { return backendName(backend()); }
+  int capacity() const { return _capacity; }
+  const ParameterEncoding &encoding() const { return _encoding; }
+
+  // GLSL declarations and the accessors of the ParameterLayout fields
+  virtual QString vertexShaderSource() const = 0;
+  // called with the linked program bound, creates the GL storage and sets up the program
+  virtual bool initialize(QOpenGLShaderProgram *program) = 0;
+  // called with another linked program bound that declares vertexShaderSource(), sets up its
+  // samplers, block bindings or uniform locations
+  virtual bool initializeProgram(QOpenGLShaderProgram * /* program */) { return true; }
+  // the program the next batches are drawn with, bound by the caller
+  virtual void setProgram(QOpenGLShaderProgram *program) { _program = program; }
+  // encode count consecutive records (SlotFloats values each) and copy them to the GPU
+  virtual void upload(int first, int count, const GLfloat *data) = 0;
+  // upload() only the runs of these records that differ from what the slots last received,
+  // returns the number of slots sent
+  int uploadChanged(int first, int count, const GLfloat *data);
+
+  // number of slots the shader can index at once
+  virtual int batchSize() const { return _capacity; }
+  int batchCount() const { return (_capacity + batchSize() - 1) / batchSize(); }
+  // make a batch visible to the shader, returns the number of slots in it
+  virtual int bindBatch(int batch);
+
+  // called once all draws reading the uploaded parameters have been submitted
+  virtual void endFrame() {}
+  virtual void destroy() = 0;
+
+  // number of times an upload had to wait for the GPU to release the storage
+  virtual qint64 fenceWaitCount() const { return 0; }
+  // bytes sent to the GL so far
+  qint64 uploadedBytes() const { return _uploadedBytes; }
+  // bytes of the buffers and textures created by initialize(), 0 for uniforms held by the programs
+  qint64 allocatedBytes() const { return _allocatedBytes; }
+
+  QByteArray glslVersion() const;
+
+  static ParameterStorage *create(Backend backend, int capacity = SlotCount,
+                                  ParameterEncoding::Encoding encoding = ParameterEncoding::selectedEncoding());
+  static bool isSupported(Backend backend, QOpenGLContext *context);
+  // false if create() would fall back to another encoding for this backend
+  static bool supportsEncoding(Backend backend, ParameterEncoding::Encoding encoding);
+
+  static Backend selectedBackend();
+  static void setSelectedBackend(Backend backend);
+  static void requestFormat(Backend backend, QSurfaceFormat &format);
+
+  static QString backendName(Backend backend);
+  static bool backendFromName(const QString &name, Backend *backend);
+  static QStringList backendNames();
+
+protected:
+  ParameterStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  // shrink the capacity to what the implementation can hold
+  void limitCapacity(int maxCapacity, const char *limit);
+  GLint integerv(GLenum pname) const;
+  // count records as encoded slots, the records themselves with the full encoding
+  const GLubyte *encodeSlots(const GLfloat *data, int count);
+
+  QOpenGLExtraFunctions *_f;
+  //bindings made while drawing go through the cache of the context
+  GLStateCache *_state;
+  QOpenGLShaderProgram *_program;
+  int _capacity;
+  ParameterEncoding _encoding;
+  qint64 _uploadedBytes;
+  qint64 _allocatedBytes;
+
+private:
+  bool isChanged(int slot, const GLfloat *record) const;
+
+  QVector<GLubyte> _staging;
+  //the records last passed to upload() by uploadChanged(), for the slots marked valid
+  QVector<GLfloat> _current;
+  QBitArray _currentValid;
+
+  static Backend _selectedBackend;
+};
+
+// plain vec4/ivec4 uniform arrays holding the float and int texels of the slots, updated with
+// glUniform4fv/glUniform4iv when a batch is bound
+class UniformStorage : public ParameterStorage
+{
+public:
+  UniformStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  Backend backend() const { return Uniform; }
+  QString vertexShaderSource() const;
+  bool initialize(QOpenGLShaderProgram *program);
+  bool initializeProgram(QOpenGLShaderProgram *program);
+  void setProgram(QOpenGLShaderProgram *program);
+  void upload(int first, int count, const GLfloat *data);
+  int batchSize() const { return _batchSize; }
+  int bindBatch(int batch);
+  void endFrame();
+  void destroy();
+
+private:
+  int _batchSize;
+  //of the current program
+  GLint _floatLocation;
+  GLint _intLocation;
+  //u_floats and u_ints of every program
+  QHash<QOpenGLShaderProgram *, QPair<GLint, GLint> > _locations;
+  //uniforms are program state, so a batch is only sent when it is bound
+  QVector<GLfloat> _shadow;
+  QVector<GLfloat> _floats;
+  QVector<GLint> _ints;
+  int _boundBatch;
+};
+
+// std140 uniform blocks, updated with glBufferSubData. Slots that do not fit into
+// GL_MAX_UNIFORM_BLOCK_SIZE are split into chunks selected with glBindBufferRange.
+class UboStorage : public ParameterStorage
+{
+public:
+  UboStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  Backend backend() const { return Ubo; }
+  QString vertexShaderSource() const;
+  bool initialize(QOpenGLShaderProgram *program);
+  bool initializeProgram(QOpenGLShaderProgram *program);
+  void upload(int first, int count, const GLfloat *data);
+  int batchSize() const { return _chunkSlots; }
+  int bindBatch(int batch);
+  void destroy();
+
+protected:
+  bool initializeBlock(QOpenGLShaderProgram *program);
+  GLintptr slotOffset(int slot) const;
+  GLsizeiptr bufferSize() const;
+
+  GLuint _uboId;
+  GLuint _uboIndex;
+  GLint _uboSize;
+  int _chunkSlots;
+  GLint _chunkStride;
+};
+
+// Ring of RingSize uniform block slices in one buffer, written through a mapping that never
+// synchronizes (persistent with ARB/EXT_buffer_storage, GL_MAP_UNSYNCHRONIZED_BIT otherwise).
+// A fence per slice keeps the CPU from overwriting a slice the GPU is still reading and
+// glBindBufferRange selects the slice of the current frame.
+class UboRingStorage : public UboStorage
+{
+public:
+  UboRingStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  Backend backend() const { return UboRing; }
+  bool initialize(QOpenGLShaderProgram *program);
+  void upload(int first, int count, const GLfloat *data);
+  int bindBatch(int batch);
+  void endFrame();
+  void destroy();
+
+  qint64 fenceWaitCount() const { return _fenceWaits; }
+
+private:
+  enum { RingSize = 3 };
+
+  typedef void (QOPENGLF_APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+  void waitForSlice(int slice);
+  void writeSlice();
+
+  GLintptr _sliceSize;
+  int _slice;
+  bool _dirty;
+  bool _frameOpen;
+  GLubyte *_persistentData;
+  GLsync _fences[RingSize];
+  //CPU copy of a whole slice, every slice needs all slots
+  QVector<GLubyte> _shadow;
+  qint64 _fenceWaits;
+};
+
+// RGBA32F (RGBA16F with the half encoding) and RGBA32I 2D textures, updated with glTexSubImage2D.
+// The float texture holds the float texels of the slots and the int texture the int texels, so
+// each one only receives its own section of the data; rows wrap at GL_MAX_TEXTURE_SIZE.
+class TextureStorage : public ParameterStorage
+{
+public:
+  TextureStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  Backend backend() const { return Texture; }
+  QString vertexShaderSource() const;
+  bool initialize(QOpenGLShaderProgram *program);
+  bool initializeProgram(QOpenGLShaderProgram *program);
+  void upload(int first, int count, const GLfloat *data);
+  int bindBatch(int batch);
+  void destroy();
+
+private:
+  int _slotsPerRow;
+  int _rows;
+  GLuint _floatStorageTexId;
+  GLuint _intStorageTexId;
+  //the encoded float and int sections of the uploaded records, split for glTexSubImage2D
+  QVector<GLfloat> _floatTexels;
+  QVector<GLfloat> _intTexels;
+};
+
+// a single buffer object viewed through RGBA32F (RGBA16F with the half encoding) and RGBA32I
+// buffer textures
+class TextureBufferStorage : public ParameterStorage
+{
+public:
+  TextureBufferStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  Backend backend() const { return TextureBuffer; }
+  QString vertexShaderSource() const;
+  bool initialize(QOpenGLShaderProgram *program);
+  bool initializeProgram(QOpenGLShaderProgram *program);
+  void upload(int first, int count, const GLfloat *data);
+  int bindBatch(int batch);
+  void destroy();
+
+private:
+  typedef void (QOPENGLF_APIENTRYP TexBufferProc)(GLenum target, GLenum internalFormat, GLuint buffer);
+
+  TexBufferProc _glTexBuffer;
+  GLuint _tboId;
+  GLuint _floatStorageTexId;
+  GLuint _intStorageTexId;
+};
+
+// std430 shader storage block, updated with glBufferSubData
+class SsboStorage : public ParameterStorage
+{
+public:
+  SsboStorage(int capacity, ParameterEncoding::Encoding encoding);
+
+  Backend backend() const { return Ssbo; }
+  QString vertexShaderSource() const;
+  bool initialize(QOpenGLShaderProgram *program);
+  void upload(int first, int count, const GLfloat *data);
+  int bindBatch(int batch);
+  void destroy();
+
+private:
+  GLuint _ssboId;
+};
+
+#endif
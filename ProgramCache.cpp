@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include "ProgramCache.h"
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+static const quint32 CacheMagic = 0x54585042; // "TXPB"
+static const quint32 CacheVersion = 1;
+
+ProgramCache::ProgramCache()
+  : _enabled(true),
+    _directory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/shaders"))
+{
+}
+
+ProgramCache *ProgramCache::instance()
+{
+  static ProgramCache cache;
+  return &cache;
+}
+
+bool ProgramCache::isSupported() const
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if (!context->isOpenGLES()
+      && context->format().version() < qMakePair(4, 1)
+      && !context->hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+    return false;
+  }
+  //drivers are allowed to support the API without any binary format
+  GLint formats = 0;
+  context->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+QByteArray ProgramCache::key(const QByteArray &sourceKey) const
+{
+  QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(sourceKey);
+  hash.addData(reinterpret_cast<const char *>(f->glGetString(GL_VENDOR)));
+  hash.addData(reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)));
+  hash.addData(reinterpret_cast<const char *>(f->glGetString(GL_VERSION)));
+  return hash.result().toHex();
+}
+
+QString ProgramCache::fileName(const QByteArray &key) const
+{
+  return _directory + QLatin1Char('/') + QString::fromLatin1(key) + QStringLiteral(".bin");
+}
+
+void ProgramCache::prepare(GLuint programId)
+{
+  if (_enabled && isSupported()) {
+    QOpenGLContext::currentContext()->extraFunctions()->glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+}
+
+bool ProgramCache::load(QOpenGLShaderProgram *program, const QByteArray &key)
+{
+  if (!_enabled || !isSupported()) {
+    return false;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QFile file(fileName(key));
+  if (!file.open(QIODevice::ReadOnly)) {
+    ++_statistics.misses;
+    return false;
+  }
+  QDataStream stream(&file);
+  quint32 magic, version, format;
+  QByteArray storedKey, binary;
+  stream >> magic >> version >> storedKey >> format >> binary;
+  file.close();
+
+  if (stream.status() != QDataStream::Ok || magic != CacheMagic || version != CacheVersion
+      || storedKey != key || binary.isEmpty()) {
+    qWarning() << "Discarding invalid shader cache entry" << file.fileName();
+    file.remove();
+    ++_statistics.misses;
+    return false;
+  }
+
+  //QOpenGLShaderProgram::link() without shaders only checks the link status of a program set up by hand
+  program->create();
+  QOpenGLContext::currentContext()->extraFunctions()->glProgramBinary(program->programId(), format, binary.constData(), binary.size());
+  if (!program->link()) {
+    qDebug() << "Driver rejected cached program binary" << file.fileName();
+    file.remove();
+    ++_statistics.misses;
+    return false;
+  }
+
+  ++_statistics.hits;
+  _statistics.loadTime += timer.nsecsElapsed();
+  return true;
+}
+
+void ProgramCache::store(QOpenGLShaderProgram *program, const QByteArray &key)
+{
+  if (!_enabled || !isSupported()) {
+    return;
+  }
+
+  QOpenGLExtraFunctions *f = QOpenGLContext::currentContext()->extraFunctions();
+  GLint length = 0;
+  f->glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  QByteArray binary(length, Qt::Uninitialized);
+  GLenum format = 0;
+  f->glGetProgramBinary(program->programId(), length, &length, &format, binary.data());
+  binary.resize(length);
+
+  if (!QDir().mkpath(_directory)) {
+    qWarning() << "Could not create shader cache directory" << _directory;
+    return;
+  }
+  //written to a temporary file first so that a concurrent reader never sees a partial entry
+  QSaveFile file(fileName(key));
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Could not write shader cache entry" << file.fileName() << file.errorString();
+    return;
+  }
+  QDataStream stream(&file);
+  stream << CacheMagic << CacheVersion << key << quint32(format) << binary;
+  file.commit();
+}
+
+void ProgramCache::addCompileTime(qint64 nsecs)
+{
+  _statistics.compileTime += nsecs;
+}
@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram);
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary). Entries are
+// keyed by a hash of the program sources and the GL vendor, renderer and version, so a driver
+// update never picks up an old binary. An entry the driver refuses is deleted and the program
+// is compiled from source instead.
+class ProgramCache
+{
+public:
+  struct Statistics
+  {
+    Statistics() : hits(0), misses(0), loadTime(0), compileTime(0) {}
+
+    int hits;
+    int misses;
+    qint64 loadTime;     // nanoseconds spent loading cached binaries
+    qint64 compileTime;  // nanoseconds from submitting sources to the program being linked
+  };
+
+  static ProgramCache *instance();
+
+  bool isEnabled() const { return _enabled; }
+  void setEnabled(bool enabled) { _enabled = enabled; }
+  QString directory() const { return _directory; }
+  void setDirectory(const QString &directory) { _directory = directory; }
+
+  // true if the current context can save and load program binaries
+  bool isSupported() const;
+  // combines the source key with the identity of the current context's driver
+  QByteArray key(const QByteArray &sourceKey) const;
+
+  // call before linking a program that is going to be stored, with any context of its group current
+  void prepare(GLuint programId);
+  bool load(QOpenGLShaderProgram *program, const QByteArray &key);
+  void store(QOpenGLShaderProgram *program, const QByteArray &key);
+
+  void addCompileTime(qint64 nsecs);
+  const Statistics &statistics() const { return _statistics; }
+
+private:
+  ProgramCache();
+
+  QString fileName(const QByteArray &key) const;
+
+  bool _enabled;
+  QString _directory;
+  Statistics _statistics;
+};
+
+#endif
@@ -0,0 +1,259 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QOpenGLContext>
+#include <QWindow>
+
+#include <algorithm>
+
+#include "CubeRenderer.h"
+#include "FrameCapture.h"
+#include "GLStateCache.h"
+#include "GridWindow.h"
+#include "RenderThread.h"
+
+RenderThread::RenderThread(QWindow *window, int rows, int columns)
+  : _window(window),
+    _rows(qMax(1, rows)),
+    _columns(qMax(1, columns)),
+    _head(0),
+    _tail(0),
+    _context(0),
+    _capture(0),
+    _exposed(false),
+    _currentTile(0),
+    _rotationSpeed(2),
+    _lastFrame(0),
+    _remainder(0),
+    _statistics(QStringLiteral("render thread"))
+{
+  _tiles.resize(_rows * _columns);
+  const int count = _tiles.count();
+  for (int index = 0; index < count; ++index) {
+    QColor clearColor;
+    clearColor.setHsv(index * 255 / qMax(1, count - 1), 255, 63);
+
+    _tiles[index].texturePath = QString(":/images/side%1.png").arg(index % 6 + 1);
+    _tiles[index].state.clearColor = clearColor;
+  }
+}
+
+RenderThread::~RenderThread()
+{
+  stop();
+}
+
+void RenderThread::post(const Command &command)
+{
+  const int head = _head.load();
+  while (head - _tail.loadAcquire() >= QueueSize) {
+    if (!isRunning()) {
+      return;
+    }
+    QThread::yieldCurrentThread();
+  }
+  //not visible to the render thread before the head moves past it
+  _queue[head % QueueSize] = command;
+  _head.storeRelease(head + 1);
+}
+
+void RenderThread::stop()
+{
+  //cleared by start(), so a stop() right after start() is not lost
+  requestInterruption();
+  wait();
+}
+
+bool RenderThread::initialize()
+{
+  //created on this thread and not shared with the GUI thread's contexts, so the share group and
+  //the SharedResources and TextureLoader objects parented to it belong to this thread
+  _context = new QOpenGLContext;
+  _context->setFormat(_window->requestedFormat());
+  if (!_context->create() || !_context->makeCurrent(_window)) {
+    qWarning("Could not create an OpenGL context on the render thread");
+    return false;
+  }
+
+  for (int i = 0; i < _tiles.count(); ++i) {
+    Tile &tile = _tiles[i];
+    tile.renderer = new CubeRenderer(tile.texturePath, ParameterStorage::selectedBackend(), CubeRenderer::selectedInstanceCount());
+    tile.renderer->setName(QStringLiteral("render thread tile %1").arg(i));
+    if (!tile.renderer->initialize()) {
+      return false;
+    }
+  }
+  if (FrameCapture::isEnabled()) {
+    _capture = new FrameCapture(QStringLiteral("render-thread"));
+  }
+  return true;
+}
+
+void RenderThread::cleanup()
+{
+  if (!_context) {
+    return;
+  }
+  _context->makeCurrent(_window);
+  if (_capture) {
+    _capture->finish();
+    delete _capture;
+    _capture = 0;
+  }
+  for (int i = 0; i < _tiles.count(); ++i) {
+    delete _tiles[i].renderer;
+    _tiles[i].renderer = 0;
+  }
+  _context->doneCurrent();
+  delete _context;
+  _context = 0;
+}
+
+void RenderThread::run()
+{
+  if (!initialize()) {
+    cleanup();
+    return;
+  }
+
+  _clock.start();
+  _lastFrame = 0;
+  _remainder = 0;
+  while (!isInterruptionRequested()) {
+    const int head = _head.loadAcquire();
+    for (int tail = _tail.load(); tail != head; ++tail) {
+      apply(_queue[tail % QueueSize]);
+    }
+    _tail.storeRelease(head);
+
+    animate();
+    if (!_exposed || _size.isEmpty()) {
+      //swapBuffers does not block on a hidden window
+      msleep(StepInterval);
+      continue;
+    }
+    //a program that failed in the background stops the thread, as a failed initialize() does
+    if (!renderFrame()) {
+      break;
+    }
+  }
+
+  cleanup();
+}
+
+void RenderThread::apply(const Command &command)
+{
+  switch (command.type) {
+  case Command::Rotate:
+    rotate(command.tile, command.x, command.y, command.z);
+    break;
+  case Command::SetCurrent:
+    _currentTile = command.tile;
+    _rotationSpeed = command.x;
+    break;
+  case Command::ToggleRotationIndex: {
+    Tile &tile = _tiles[command.tile];
+    tile.state.rotIndex = (tile.state.rotIndex == 0) ? 1 : 0;
+    tile.renderer->prepare(tile.state);
+    break;
+  }
+  case Command::Resize:
+    _size = QSize(command.x, command.y);
+    break;
+  case Command::Expose:
+    _exposed = command.x != 0;
+    break;
+  }
+}
+
+void RenderThread::rotate(int index, int xAngle, int yAngle, int zAngle)
+{
+  Tile &tile = _tiles[index];
+  tile.state.xRot += xAngle;
+  tile.state.yRot += yAngle;
+  tile.state.zRot += zAngle;
+  tile.renderer->prepare(tile.state);
+}
+
+void RenderThread::animate()
+{
+  //by the time since the last frame, so the speed does not depend on the refresh rate
+  const qint64 nsecsPerStep = qint64(StepInterval) * 1000000;
+  const qint64 now = _clock.nsecsElapsed();
+  _statistics.record(FrameStatistics::FrameInterval, now - _lastFrame);
+  _remainder += (now - _lastFrame) * _rotationSpeed * 16;
+  _lastFrame = now;
+  const int angle = int(_remainder / nsecsPerStep);
+  _remainder -= angle * nsecsPerStep;
+  if (angle != 0) {
+    rotate(_currentTile, angle, angle, -angle);
+  }
+}
+
+bool RenderThread::renderFrame()
+{
+  _context->makeCurrent(_window);
+  _statistics.beginPaint();
+  //nothing but the renderers uses this context, the cached bindings stay valid across frames
+  QVector<QPair<Material::Set, int> > order;
+  for (int i = 0; i < _tiles.count(); ++i) {
+    order.append(qMakePair(_tiles[i].renderer->permutation(_tiles[i].state), i));
+  }
+  //grouped by material permutation, so the program changes least often
+  std::sort(order.begin(), order.end());
+  for (int j = 0; j < order.count(); ++j) {
+    const int i = order[j].second;
+    //GL window coordinates start at the bottom left
+    const QRect rect = GridWindow::tileRect(i, _rows, _columns, _size);
+    _tiles[i].renderer->setTile(QRect(rect.x(), _size.height() - rect.y() - rect.height(), rect.width(), rect.height()));
+    _tiles[i].renderer->render(_tiles[i].state);
+    if (_tiles[i].renderer->hasFailed()) {
+      return false;
+    }
+  }
+  //from the back buffer, before it is swapped
+  if (_capture) {
+    _capture->capture(QRect(QPoint(0, 0), _size));
+  }
+  //the CPU time of the frame, without waiting for vsync in swapBuffers()
+  _statistics.endPaint();
+  _context->swapBuffers(_window);
+  return true;
+}
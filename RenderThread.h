@@ -0,0 +1,157 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSize>
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+#include "CubeState.h"
+#include "FrameStatistics.h"
+
+class CubeRenderer;
+class FrameCapture;
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext);
+QT_FORWARD_DECLARE_CLASS(QWindow);
+
+// Draws a grid of cube tiles into a window from its own thread and its own QOpenGLContext, so a
+// busy GUI thread never delays a frame. The GUI thread only posts commands; the render thread
+// applies them at the start of every frame, advances the animation of the current tile by the
+// elapsed time and presents with swapBuffers, which waits for vsync with the default swap interval.
+//
+// Commands go through a fixed size ring with atomic head and tail indexes: one thread may post,
+// the render thread reads, neither takes a lock. The tiles, renderers and the context are only
+// touched by the render thread.
+class RenderThread : public QThread
+{
+  Q_OBJECT
+
+public:
+  struct Command
+  {
+    enum Type
+    {
+      Rotate,               // add x, y and z to the angles of tile
+      SetCurrent,           // tile rotates by x * 16 every StepInterval
+      ToggleRotationIndex,  // of tile
+      Resize,               // the window has x * y pixels
+      Expose                // the window is exposed if x is non-zero
+    };
+
+    Command(Type type = Rotate, int tile = 0, int x = 0, int y = 0, int z = 0)
+      : type(type), tile(tile), x(x), y(y), z(z) {}
+
+    Type type;
+    int tile;
+    int x;
+    int y;
+    int z;
+  };
+
+  // the window must be an OpenGLSurface and outlive the thread
+  RenderThread(QWindow *window, int rows, int columns);
+  // stops the thread
+  ~RenderThread();
+
+  // GUI thread only; waits for room if the render thread fell QueueSize commands behind. Commands
+  // posted while the thread is not running are applied once it starts, as far as they fit.
+  void post(const Command &command);
+  // waits until the render thread has released the context and the renderers
+  void stop();
+
+  // the current tile turns by its speed * 16 every StepInterval milliseconds, as with AnimationScheduler
+  enum { StepInterval = 20 };
+
+protected:
+  void run();
+
+private:
+  enum { QueueSize = 1024 };
+
+  struct Tile
+  {
+    Tile() : renderer(0) {}
+
+    CubeState state;
+    QString texturePath;
+    CubeRenderer *renderer;
+  };
+
+  bool initialize();
+  void cleanup();
+  void apply(const Command &command);
+  void rotate(int index, int xAngle, int yAngle, int zAngle);
+  void animate();
+  // false if a renderer failed
+  bool renderFrame();
+
+  QWindow *_window;
+  int _rows;
+  int _columns;
+
+  //posted by the GUI thread, commands [tail, head) are waiting
+  Command _queue[QueueSize];
+  QAtomicInt _head;
+  QAtomicInt _tail;
+
+  //render thread only
+  QOpenGLContext *_context;
+  QVector<Tile> _tiles;
+  //null unless frames are captured
+  FrameCapture *_capture;
+  QSize _size;
+  bool _exposed;
+  int _currentTile;
+  int _rotationSpeed;
+  QElapsedTimer _clock;
+  qint64 _lastFrame;
+  //angle * nanoseconds not applied yet
+  qint64 _remainder;
+  //recorded on the render thread, read by the GUI thread's reporting
+  FrameStatistics _statistics;
+};
+
+#endif
@@ -0,0 +1,484 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QCoreApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+#include "ProgramCache.h"
+#include "ShaderCompiler.h"
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+
+bool ShaderCompiler::_asyncEnabled = true;
+QElapsedTimer ShaderCompiler::_startup;
+QAtomicInt ShaderCompiler::_firstFrameLogged;
+QAtomicInt ShaderCompiler::_firstCompleteFrameLogged;
+
+// A thread with its own context in the share group, compiling the queued jobs until there are
+// none left. The context and surface are created on the GUI thread, which is where offscreen
+// surfaces have to be created.
+class ShaderCompiler::Worker : public QThread
+{
+public:
+  Worker(ShaderCompiler *compiler, QOpenGLContext *shareContext)
+    : _compiler(compiler),
+      _context(new QOpenGLContext)
+  {
+    _surface.setFormat(shareContext->format());
+    _surface.create();
+    _context->setFormat(shareContext->format());
+    _context->setShareContext(shareContext);
+    _context->create();
+    _context->moveToThread(this);
+  }
+
+  ~Worker()
+  {
+    delete _context;
+  }
+
+  void run()
+  {
+    const bool current = _context->isValid() && _context->makeCurrent(&_surface);
+    if (!current) {
+      qWarning("Could not make a background shader compiler context current, compiling on the render thread");
+    }
+    forever {
+      QSharedPointer<Job> job;
+      {
+        QMutexLocker locker(&_compiler->_mutex);
+        if (_compiler->_queue.isEmpty() || _compiler->_stopping) {
+          //decided under the lock, so submit() starts another worker for anything queued after this
+          --_compiler->_activeWorkers;
+          break;
+        }
+        job = _compiler->_queue.takeFirst();
+      }
+
+      if (current) {
+        QOpenGLExtraFunctions *f = _context->extraFunctions();
+        startLink(f, job.data());
+        finishLink(f, job.data());
+        //the render thread's context only sees the result once the commands are done
+        f->glFinish();
+      } else {
+        job->retry = true;
+      }
+      {
+        QMutexLocker locker(&_compiler->_mutex);
+        job->done.storeRelease(1);
+        _compiler->_jobDone.wakeAll();
+      }
+      emit _compiler->compiled();
+    }
+    if (current) {
+      _context->doneCurrent();
+    }
+    //deleted here, the thread it belongs to
+    delete _context;
+    _context = 0;
+  }
+
+private:
+  ShaderCompiler *_compiler;
+  QOpenGLContext *_context;
+  QOffscreenSurface _surface;
+};
+
+ShaderCompiler::ShaderCompiler(QObject *parent)
+  : QObject(parent),
+    _mechanism(Synchronous),
+    _submitted(0),
+    _pollTimer(new QTimer(this)),
+    _activeWorkers(0),
+    _stopping(false)
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if (_asyncEnabled) {
+    const bool khr = context->hasExtension(QByteArrayLiteral("GL_KHR_parallel_shader_compile"));
+    if (khr || context->hasExtension(QByteArrayLiteral("GL_ARB_parallel_shader_compile"))) {
+      MaxShaderCompilerThreads maxThreads = reinterpret_cast<MaxShaderCompilerThreads>(
+        context->getProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+      if (maxThreads) {
+        //let the driver use as many threads as it likes
+        maxThreads(0xFFFFFFFF);
+        _mechanism = ParallelExtension;
+      }
+    }
+    //offscreen surfaces are created on the GUI thread, the render thread compiles by itself
+    if (_mechanism == Synchronous && QCoreApplication::instance()
+        && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+      _mechanism = BackgroundContext;
+    }
+  }
+
+  _pollTimer->setInterval(PollInterval);
+  connect(_pollTimer, SIGNAL(timeout()), this, SIGNAL(compiled()));
+  if (_mechanism == BackgroundContext) {
+    connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(stopWorkers()));
+  }
+  qDebug("Compiling shader programs %s", qPrintable(mechanismName(_mechanism)));
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+  stopWorkers();
+}
+
+QString ShaderCompiler::mechanismName(Mechanism mechanism)
+{
+  switch (mechanism) {
+  case ParallelExtension:
+    return QStringLiteral("with the driver's parallel shader compile extension");
+  case BackgroundContext:
+    return QStringLiteral("on background shared contexts");
+  case Synchronous:
+    break;
+  }
+  return QStringLiteral("synchronously");
+}
+
+bool ShaderCompiler::isAsyncEnabled()
+{
+  return _asyncEnabled;
+}
+
+void ShaderCompiler::setAsyncEnabled(bool enabled)
+{
+  _asyncEnabled = enabled;
+}
+
+void ShaderCompiler::startTiming()
+{
+  _startup.start();
+}
+
+void ShaderCompiler::frameDrawn(bool complete)
+{
+  if (!_startup.isValid()) {
+    return;
+  }
+  if (_firstFrameLogged.testAndSetOrdered(0, 1)) {
+    qDebug("First frame drawn %.1f ms after start%s", _startup.nsecsElapsed() / 1e6,
+           complete ? "" : ", shader programs still compiling");
+  }
+  if (complete && _firstCompleteFrameLogged.testAndSetOrdered(0, 1)) {
+    qDebug("First frame with its shader programs drawn %.1f ms after start", _startup.nsecsElapsed() / 1e6);
+  }
+}
+
+bool ShaderCompiler::submit(const QSharedPointer<QOpenGLShaderProgram> &program, const QString &name, const QByteArray &cacheKey,
+                            const QString &vertexSource, const QString &fragmentSource, const QMap<QByteArray, int> &attributeLocations)
+{
+  if (!_timer.isValid()) {
+    _timer.start();
+  }
+  ++_submitted;
+  reapWorkers();
+
+  if (_mechanism == Synchronous) {
+    QElapsedTimer timer;
+    timer.start();
+    if (!compileNow(program.data(), vertexSource, fragmentSource, attributeLocations)) {
+      return false;
+    }
+    const qint64 compileTime = timer.nsecsElapsed();
+    ProgramCache *cache = ProgramCache::instance();
+    cache->addCompileTime(compileTime);
+    cache->store(program.data(), cacheKey);
+    qDebug("Compiled shared shader program %s in %.2f ms", qPrintable(name), compileTime / 1e6);
+    return true;
+  }
+
+  QSharedPointer<Job> job(new Job);
+  //held until the job is finished, a worker may be linking it
+  job->program = program;
+  job->name = name;
+  job->cacheKey = cacheKey;
+  job->vertexSource = vertexSource;
+  job->fragmentSource = fragmentSource;
+  job->attributeLocations = attributeLocations;
+  job->timer.start();
+  program->create();
+  job->programId = program->programId();
+  //here rather than on a worker, the cache is not thread safe; the hint is program state the workers see
+  ProgramCache::instance()->prepare(job->programId);
+  _jobs.insert(program.data(), job);
+
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if (_mechanism == ParallelExtension) {
+    startLink(context->extraFunctions(), job.data());
+    _pollTimer->start();
+    return true;
+  }
+
+  //the new program object has to reach the workers' contexts
+  context->functions()->glFlush();
+  bool startWorker = false;
+  {
+    QMutexLocker locker(&_mutex);
+    _queue.append(job);
+    if (_activeWorkers < qBound(1, QThread::idealThreadCount() - 1, int(MaxWorkers))) {
+      ++_activeWorkers;
+      startWorker = true;
+    }
+  }
+  if (startWorker) {
+    Worker *worker = new Worker(this, context);
+    _workers.append(worker);
+    worker->start();
+  }
+  return true;
+}
+
+void ShaderCompiler::startLink(QOpenGLExtraFunctions *f, Job *job)
+{
+  const QString sources[2] = { job->vertexSource, job->fragmentSource };
+  const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+  for (int i = 0; i < 2; ++i) {
+    const QByteArray source = sources[i].toUtf8();
+    const char *data = source.constData();
+    job->shaders[i] = f->glCreateShader(types[i]);
+    f->glShaderSource(job->shaders[i], 1, &data, 0);
+    f->glCompileShader(job->shaders[i]);
+    f->glAttachShader(job->programId, job->shaders[i]);
+  }
+  for (QMap<QByteArray, int>::const_iterator it = job->attributeLocations.constBegin(); it != job->attributeLocations.constEnd(); ++it) {
+    f->glBindAttribLocation(job->programId, it.value(), it.key().constData());
+  }
+  f->glLinkProgram(job->programId);
+}
+
+void ShaderCompiler::finishLink(QOpenGLExtraFunctions *f, Job *job)
+{
+  const char *names[2] = { "vertex", "fragment" };
+  for (int i = 0; i < 2; ++i) {
+    GLint compiled = 0;
+    f->glGetShaderiv(job->shaders[i], GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+      GLint length = 0;
+      f->glGetShaderiv(job->shaders[i], GL_INFO_LOG_LENGTH, &length);
+      QByteArray log(qMax(length, 1), '\0');
+      f->glGetShaderInfoLog(job->shaders[i], log.size(), 0, log.data());
+      job->log += QStringLiteral("Could not compile %1 shader: %2\n").arg(QLatin1String(names[i]), QString::fromUtf8(log.constData()));
+    }
+    f->glDetachShader(job->programId, job->shaders[i]);
+    f->glDeleteShader(job->shaders[i]);
+    job->shaders[i] = 0;
+  }
+  GLint linked = 0;
+  f->glGetProgramiv(job->programId, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    GLint length = 0;
+    f->glGetProgramiv(job->programId, GL_INFO_LOG_LENGTH, &length);
+    QByteArray log(qMax(length, 1), '\0');
+    f->glGetProgramInfoLog(job->programId, log.size(), 0, log.data());
+    job->log += QStringLiteral("Could not link shader program: %1").arg(QString::fromUtf8(log.constData()));
+  }
+}
+
+bool ShaderCompiler::compileNow(QOpenGLShaderProgram *program, const QString &vertexSource, const QString &fragmentSource,
+                                const QMap<QByteArray, int> &attributeLocations)
+{
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource)) {
+    qDebug("Could not add vertex shader. Error log is:");
+    qWarning() << program->log();
+    return false;
+  }
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource)) {
+    qDebug("Could not add fragment shader. Error log is:");
+    qWarning() << program->log();
+    return false;
+  }
+  for (QMap<QByteArray, int>::const_iterator it = attributeLocations.constBegin(); it != attributeLocations.constEnd(); ++it) {
+    program->bindAttributeLocation(it.key(), it.value());
+  }
+  ProgramCache::instance()->prepare(program->programId());
+  if (!program->link()) {
+    qDebug("Could not link shader program. Error log is:");
+    qWarning() << program->log();
+    return false;
+  }
+  return true;
+}
+
+bool ShaderCompiler::isDone(Mechanism mechanism, Job *job)
+{
+  if (mechanism == ParallelExtension) {
+    GLint done = 0;
+    QOpenGLContext::currentContext()->functions()->glGetProgramiv(job->programId, GL_COMPLETION_STATUS_KHR, &done);
+    return done != 0;
+  }
+  return job->done.loadAcquire() != 0;
+}
+
+void ShaderCompiler::finish(Mechanism mechanism, Job *job)
+{
+  QOpenGLExtraFunctions *f = QOpenGLContext::currentContext()->extraFunctions();
+  bool linked = false;
+  if (job->retry) {
+    //no background context could take it
+    linked = compileNow(job->program.data(), job->vertexSource, job->fragmentSource, job->attributeLocations);
+  } else {
+    if (mechanism == ParallelExtension) {
+      finishLink(f, job);
+    }
+    //checked first: QOpenGLShaderProgram::link() relinks a program that is not linked, which has no shaders left
+    GLint status = 0;
+    f->glGetProgramiv(job->programId, GL_LINK_STATUS, &status);
+    linked = status && job->program->link();
+    if (!linked) {
+      qDebug("Could not build shader program %s. Error log is:", qPrintable(job->name));
+      qWarning() << job->log;
+    }
+  }
+
+  job->status = linked ? Ready : Failed;
+  if (linked) {
+    const qint64 compileTime = job->timer.nsecsElapsed();
+    ProgramCache *cache = ProgramCache::instance();
+    cache->addCompileTime(compileTime);
+    cache->store(job->program.data(), job->cacheKey);
+    qDebug("Compiled shared shader program %s %.2f ms after submitting it", qPrintable(job->name), compileTime / 1e6);
+  }
+}
+
+ShaderCompiler::Status ShaderCompiler::poll(QOpenGLShaderProgram *program, bool wait)
+{
+  //every pending job is checked, not just program's, so programs nobody draws with get done too
+  bool finished = false;
+  for (QHash<QOpenGLShaderProgram *, QSharedPointer<Job> >::iterator it = _jobs.begin(); it != _jobs.end(); ++it) {
+    Job *job = it.value().data();
+    if (job->status != Pending) {
+      continue;
+    }
+    if (wait && it.key() == program && _mechanism == BackgroundContext) {
+      QMutexLocker locker(&_mutex);
+      while (!job->done.loadAcquire()) {
+        _jobDone.wait(&_mutex);
+      }
+    }
+    //the link status query blocks until the driver is done
+    if ((wait && it.key() == program) || isDone(_mechanism, job)) {
+      finish(_mechanism, job);
+      finished = true;
+    }
+  }
+
+  Status status = Ready;
+  const QSharedPointer<Job> job = _jobs.value(program);
+  if (job) {
+    status = job->status;
+  }
+  //failed jobs are kept for their status
+  for (QHash<QOpenGLShaderProgram *, QSharedPointer<Job> >::iterator it = _jobs.begin(); it != _jobs.end();) {
+    if (it.value()->status == Ready) {
+      it = _jobs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (finished && pendingCount() == 0) {
+    _pollTimer->stop();
+    reapWorkers();
+    QString sinceStart;
+    if (_startup.isValid()) {
+      sinceStart = QStringLiteral(", %1 ms after start").arg(_startup.nsecsElapsed() / 1e6, 0, 'f', 1);
+    }
+    qDebug("All %d shader programs of the share group ready %.1f ms after the first was submitted%s",
+           _submitted, _timer.nsecsElapsed() / 1e6, qPrintable(sinceStart));
+  }
+  return status;
+}
+
+int ShaderCompiler::pendingCount() const
+{
+  int count = 0;
+  for (QHash<QOpenGLShaderProgram *, QSharedPointer<Job> >::const_iterator it = _jobs.constBegin(); it != _jobs.constEnd(); ++it) {
+    if (it.value()->status == Pending) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void ShaderCompiler::reapWorkers()
+{
+  for (int i = _workers.count() - 1; i >= 0; --i) {
+    if (_workers[i]->isFinished()) {
+      delete _workers.takeAt(i);
+    }
+  }
+}
+
+void ShaderCompiler::stopWorkers()
+{
+  {
+    QMutexLocker locker(&_mutex);
+    _stopping = true;
+    //left to poll() to compile by itself
+    for (int i = 0; i < _queue.count(); ++i) {
+      _queue[i]->retry = true;
+      _queue[i]->done.storeRelease(1);
+    }
+    _queue.clear();
+    _jobDone.wakeAll();
+  }
+  for (int i = 0; i < _workers.count(); ++i) {
+    _workers[i]->wait();
+    delete _workers[i];
+  }
+  _workers.clear();
+}
@@ -0,0 +1,179 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef SHADERCOMPILER_H
+#define SHADERCOMPILER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QWaitCondition>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLExtraFunctions);
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram);
+QT_FORWARD_DECLARE_CLASS(QTimer);
+
+// Compiles and links the shader programs of a share group without blocking the thread that draws
+// with them. submit() starts a program and returns at once; poll() tells whether it is linked,
+// and finishes the programs that are done, storing them in the ProgramCache. The work is done by
+//  - the driver, through KHR_parallel_shader_compile or ARB_parallel_shader_compile, where the
+//    compile and link calls return at once and GL_COMPLETION_STATUS is polled;
+//  - otherwise by background threads with their own contexts sharing the group, up to
+//    MaxWorkers, which exit when there is nothing left to compile. These need the group to be
+//    created on the GUI thread, which owns the offscreen surfaces;
+//  - otherwise, or when asynchronous compilation is disabled, submit() itself.
+//
+// compiled() is emitted whenever a program may have finished, so surfaces drawing a fallback
+// know when to draw again. The time from startTiming() to the first frame, to the first frame
+// drawn with its programs and to all programs of a group being ready is logged.
+class ShaderCompiler : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum Mechanism {
+    Synchronous,
+    ParallelExtension,
+    BackgroundContext
+  };
+
+  enum Status {
+    Pending,
+    Ready,
+    Failed
+  };
+
+  // needs a current context of the group, which picks the mechanism
+  explicit ShaderCompiler(QObject *parent = 0);
+  ~ShaderCompiler();
+
+  Mechanism mechanism() const { return _mechanism; }
+
+  // needs a current context of the group; starts compiling program, which must not be created yet,
+  // and holds it until it is done. Returns false if the program failed at once, its log is printed.
+  bool submit(const QSharedPointer<QOpenGLShaderProgram> &program, const QString &name, const QByteArray &cacheKey,
+              const QString &vertexSource, const QString &fragmentSource, const QMap<QByteArray, int> &attributeLocations);
+  // needs a current context of the group; finishes the programs that are done and returns the
+  // status of program, with wait once it is no longer pending. Programs not submitted are Ready.
+  Status poll(QOpenGLShaderProgram *program, bool wait = false);
+  int pendingCount() const;
+
+  static QString mechanismName(Mechanism mechanism);
+  static bool isAsyncEnabled();
+  static void setAsyncEnabled(bool enabled);
+
+  // the start of the application, for the startup times
+  static void startTiming();
+  // called for every frame a renderer draws, complete if it was drawn with its programs; from any thread
+  static void frameDrawn(bool complete);
+
+signals:
+  // emitted from any thread when a program may have finished
+  void compiled();
+
+private slots:
+  void stopWorkers();
+
+private:
+  enum { MaxWorkers = 4, PollInterval = 10 };
+
+  class Worker;
+  friend class Worker;
+
+  struct Job
+  {
+    Job() : programId(0), status(Pending), done(0), retry(false) { shaders[0] = shaders[1] = 0; }
+
+    QSharedPointer<QOpenGLShaderProgram> program;
+    GLuint programId;
+    QString name;
+    QByteArray cacheKey;
+    QString vertexSource;
+    QString fragmentSource;
+    QMap<QByteArray, int> attributeLocations;
+    QElapsedTimer timer;
+    GLuint shaders[2];
+    Status status;
+    //set by a worker once the link is finished, or retry if it could not run the job
+    QAtomicInt done;
+    bool retry;
+    QString log;
+  };
+
+  // compiles, attaches and links, only blocking as much as the driver does; the ProgramCache has
+  // prepared the program already
+  static void startLink(QOpenGLExtraFunctions *f, Job *job);
+  // collects the shader logs and deletes the shaders, the link must be complete
+  static void finishLink(QOpenGLExtraFunctions *f, Job *job);
+  static bool compileNow(QOpenGLShaderProgram *program, const QString &vertexSource, const QString &fragmentSource,
+                  const QMap<QByteArray, int> &attributeLocations);
+  static bool isDone(Mechanism mechanism, Job *job);
+  static void finish(Mechanism mechanism, Job *job);
+  void reapWorkers();
+
+  Mechanism _mechanism;
+  QHash<QOpenGLShaderProgram *, QSharedPointer<Job> > _jobs;
+  int _submitted;
+  QElapsedTimer _timer;
+  //emits compiled() while the driver links, nothing else would tell
+  QTimer *_pollTimer;
+  QList<Worker *> _workers;
+  //shared with the workers
+  QMutex _mutex;
+  QWaitCondition _jobDone;
+  QList<QSharedPointer<Job> > _queue;
+  int _activeWorkers;
+  bool _stopping;
+
+  static bool _asyncEnabled;
+  static QElapsedTimer _startup;
+  static QAtomicInt _firstFrameLogged;
+  static QAtomicInt _firstCompleteFrameLogged;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QDebug>
+
+#include "GpuMemory.h"
+#include "ProgramCache.h"
+#include "ShaderCompiler.h"
+#include "SharedResources.h"
+#include "TextureLoader.h"
+
+SharedResources::SharedResources(QObject *parent)
+  : QObject(parent),
+    _memory(new GpuMemory(this)),
+    _textureLoader(new TextureLoader(_memory, this)),
+    _shaderCompiler(new ShaderCompiler(this))
+{
+}
+
+SharedResources *SharedResources::current()
+{
+  //owned by the share group, so it goes away together with the group
+  QOpenGLContextGroup *group = QOpenGLContext::currentContext()->shareGroup();
+  SharedResources *resources = group->findChild<SharedResources *>(QString(), Qt::FindDirectChildrenOnly);
+  if (!resources) {
+    resources = new SharedResources(group);
+  }
+  return resources;
+}
+
+QSharedPointer<QOpenGLShaderProgram> SharedResources::program(const QString &vertexSource, const QString &fragmentSource,
+                                                              const QMap<QByteArray, int> &attributeLocations)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(vertexSource.toUtf8());
+  hash.addData(fragmentSource.toUtf8());
+  //attribute locations are baked into a program binary, so they are part of the key
+  for (QMap<QByteArray, int>::const_iterator it = attributeLocations.constBegin(); it != attributeLocations.constEnd(); ++it) {
+    hash.addData(it.key() + '=' + QByteArray::number(it.value()) + ';');
+  }
+  const QByteArray key = hash.result();
+
+  QSharedPointer<QOpenGLShaderProgram> program = _programs.value(key).toStrongRef();
+  if (program) {
+    return program;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  ProgramCache *cache = ProgramCache::instance();
+  const QByteArray cacheKey = cache->key(key);
+
+  program = QSharedPointer<QOpenGLShaderProgram>(new QOpenGLShaderProgram);
+  if (cache->load(program.data(), cacheKey)) {
+    qDebug("Loaded shared shader program %s from cache in %.2f ms", key.toHex().left(8).constData(), timer.nsecsElapsed() / 1e6);
+    _programs.insert(key, program);
+    return program;
+  }
+
+  //a program the driver refused a binary for is not reused
+  program = QSharedPointer<QOpenGLShaderProgram>(new QOpenGLShaderProgram);
+  if (!_shaderCompiler->submit(program, QString::fromLatin1(key.toHex().left(8)), cacheKey,
+                               vertexSource, fragmentSource, attributeLocations)) {
+    return QSharedPointer<QOpenGLShaderProgram>();
+  }
+  _programs.insert(key, program);
+  return program;
+}
+
+QSharedPointer<QOpenGLTexture> SharedResources::texture(const QString &imagePath)
+{
+  QSharedPointer<QOpenGLTexture> texture = _textures.value(imagePath).toStrongRef();
+  if (texture) {
+    return texture;
+  }
+
+  texture = _textureLoader->load(imagePath);
+  _textures.insert(imagePath, texture);
+  return texture;
+}
+
+QSharedPointer<QOpenGLTexture> SharedResources::textureArray(const QStringList &imagePaths)
+{
+  const QString key = QStringLiteral("array:") + imagePaths.join(QLatin1Char('|'));
+  QSharedPointer<QOpenGLTexture> texture = _textures.value(key).toStrongRef();
+  if (texture) {
+    return texture;
+  }
+
+  texture = _textureLoader->loadArray(key, imagePaths);
+  _textures.insert(key, texture);
+  return texture;
+}
+
+QSharedPointer<const Mesh> SharedResources::mesh(const QString &path)
+{
+  QSharedPointer<const Mesh> mesh = _meshes.value(path).toStrongRef();
+  if (mesh) {
+    return mesh;
+  }
+
+  //the cube and every loaded mesh fit into the same box, so the projection suits both
+  const float halfSize = 0.2f;
+  if (path.isEmpty()) {
+    mesh = QSharedPointer<const Mesh>(new Mesh(Mesh::cube(halfSize)));
+  }
+  else {
+    QElapsedTimer timer;
+    timer.start();
+    Mesh *loaded = new Mesh;
+    QString error;
+    if (!loaded->loadObj(path, &error)) {
+      qWarning() << "Cannot load mesh" << path << ":" << error;
+      delete loaded;
+      return QSharedPointer<const Mesh>();
+    }
+    loaded->fit(halfSize);
+    const double loadedRatio = loaded->averageCacheMissRatio();
+    loaded->optimize();
+    qDebug() << "Loaded mesh" << path << "with" << loaded->vertexCount() << "vertices and" << loaded->indexCount() / 3
+             << "triangles in" << timer.elapsed() << "ms, ACMR" << loadedRatio << "->" << loaded->averageCacheMissRatio();
+    mesh = QSharedPointer<const Mesh>(loaded);
+  }
+  _meshes.insert(path, mesh);
+  return mesh;
+}
+
+QSharedPointer<QOpenGLBuffer> SharedResources::vertexBuffer(const QSharedPointer<const Mesh> &mesh, Mesh::VertexFormat format)
+{
+  const QString key = QStringLiteral("vertex:%1:%2").arg(Mesh::vertexFormatName(format), mesh->name());
+  QSharedPointer<QOpenGLBuffer> buffer = _buffers.value(key).toStrongRef();
+  if (buffer) {
+    return buffer;
+  }
+
+  buffer = createBuffer(key, QOpenGLBuffer::VertexBuffer, mesh->vertexData(format));
+  _buffers.insert(key, buffer);
+  return buffer;
+}
+
+QSharedPointer<QOpenGLBuffer> SharedResources::indexBuffer(const QSharedPointer<const Mesh> &mesh)
+{
+  const QString key = QStringLiteral("index:") + mesh->name();
+  QSharedPointer<QOpenGLBuffer> buffer = _buffers.value(key).toStrongRef();
+  if (buffer) {
+    return buffer;
+  }
+
+  //binding an index buffer changes the bound vertex array, the caller binds its own afterwards
+  buffer = createBuffer(key, QOpenGLBuffer::IndexBuffer, mesh->indexData());
+  _buffers.insert(key, buffer);
+  return buffer;
+}
+
+QSharedPointer<QOpenGLBuffer> SharedResources::createBuffer(const QString &key, QOpenGLBuffer::Type type, const QByteArray &data)
+{
+  //the memory lives as long as the group, which outlives the handles
+  GpuMemory *memory = _memory;
+  QSharedPointer<QOpenGLBuffer> buffer(new QOpenGLBuffer(type), [memory](QOpenGLBuffer *buffer) {
+    memory->untrack(buffer);
+    buffer->destroy();
+    delete buffer;
+  });
+  buffer->create();
+  buffer->bind();
+  buffer->allocate(data.constData(), data.size());
+  _memory->track(buffer.data(), GpuMemory::Buffer, key, data.size());
+  return buffer;
+}
@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef SHAREDRESOURCES_H
+#define SHAREDRESOURCES_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QOpenGLBuffer>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QWeakPointer>
+
+#include "Mesh.h"
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram);
+QT_FORWARD_DECLARE_CLASS(QOpenGLTexture);
+
+class GpuMemory;
+class ShaderCompiler;
+class TextureLoader;
+
+// Cache of GL objects that can be shared by every context of a share group: shader programs,
+// textures, meshes and their vertex and index buffers. Handles are reference counted; the GL object is deleted
+// when the last handle goes away, so handles must be released with a context of the group current.
+// The textures and buffers are tracked in memory() from creation to deletion.
+// Container objects (VAOs) and per-widget parameter storage are not shareable and stay with
+// their owner.
+class SharedResources : public QObject
+{
+  Q_OBJECT
+
+public:
+  // the instance for the share group of the current context, created on first use
+  static SharedResources *current();
+
+  // a program loaded from the ProgramCache, or one submitted to shaderCompiler() that may still be
+  // compiling: poll it before use. Null if compiling or linking fails at once, the log is printed
+  QSharedPointer<QOpenGLShaderProgram> program(const QString &vertexSource, const QString &fragmentSource,
+                                               const QMap<QByteArray, int> &attributeLocations);
+  // estimated GPU memory of the group, the budget is enforced by textureLoader()
+  GpuMemory *memory() const { return _memory; }
+  TextureLoader *textureLoader() const { return _textureLoader; }
+  ShaderCompiler *shaderCompiler() const { return _shaderCompiler; }
+  // a placeholder until the image has been decoded in the background and uploaded by textureLoader()
+  QSharedPointer<QOpenGLTexture> texture(const QString &imagePath);
+  // a GL_TEXTURE_2D_ARRAY with one layer per image, loaded like texture()
+  QSharedPointer<QOpenGLTexture> textureArray(const QStringList &imagePaths);
+  // the OBJ file at path, fitted to the size of the cube, or the cube for an empty path; null if
+  // the file cannot be loaded, the error is printed
+  QSharedPointer<const Mesh> mesh(const QString &path);
+  QSharedPointer<QOpenGLBuffer> vertexBuffer(const QSharedPointer<const Mesh> &mesh, Mesh::VertexFormat format);
+  QSharedPointer<QOpenGLBuffer> indexBuffer(const QSharedPointer<const Mesh> &mesh);
+
+private:
+  explicit SharedResources(QObject *parent);
+
+  // a buffer holding data, tracked under key until its last handle goes
+  QSharedPointer<QOpenGLBuffer> createBuffer(const QString &key, QOpenGLBuffer::Type type, const QByteArray &data);
+
+  GpuMemory *_memory;
+  TextureLoader *_textureLoader;
+  ShaderCompiler *_shaderCompiler;
+  QHash<QByteArray, QWeakPointer<QOpenGLShaderProgram> > _programs;
+  QHash<QString, QWeakPointer<QOpenGLTexture> > _textures;
+  QHash<QString, QWeakPointer<const Mesh> > _meshes;
+  QHash<QString, QWeakPointer<QOpenGLBuffer> > _buffers;
+};
+
+#endif
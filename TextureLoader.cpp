@@ -0,0 +1,574 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLTexture>
+#include <QRunnable>
+#include <QDebug>
+
+#include <string.h>
+
+#include "GpuMemory.h"
+#include "KtxFile.h"
+#include "TextureLoader.h"
+
+#ifndef GL_COMPRESSED_R11_EAC
+#define GL_COMPRESSED_R11_EAC 0x9270
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC 0x9279
+#endif
+
+QString TextureLoader::_compressedDirectory;
+
+class TextureLoader::DecodeTask : public QRunnable
+{
+public:
+  DecodeTask(TextureLoader *loader, const QString &key, const QStringList &imagePaths,
+             const QVector<GLint> &compressedFormats = QVector<GLint>(), bool mipChain = false)
+    : _loader(loader), _key(key), _imagePaths(imagePaths), _compressedFormats(compressedFormats), _mipChain(mipChain) {}
+
+  void run()
+  {
+    Decoded decoded;
+    decoded.key = _key;
+    if (_imagePaths.count() == 1 && openCompressed(&decoded)) {
+      //the file holds the levels to stream
+      decoded.mipChain = _mipChain;
+      _loader->finishDecode(decoded);
+      return;
+    }
+
+    QSize size;
+    foreach (const QString &imagePath, _imagePaths) {
+      QImage image = QImage(imagePath).mirrored().convertToFormat(QImage::Format_RGBA8888);
+      if (image.isNull()) {
+        qWarning() << "Could not load texture image" << imagePath;
+        decoded.layers.clear();
+        _loader->finishDecode(decoded);
+        return;
+      }
+      size = size.expandedTo(image.size());
+      decoded.layers << image;
+    }
+    //the layers of an array share one size
+    for (int i = 0; i < decoded.layers.count(); ++i) {
+      if (decoded.layers[i].size() != size) {
+        decoded.layers[i] = decoded.layers[i].scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+      }
+    }
+    //a streamed image brings its levels, they are uploaded before the image itself
+    if (_mipChain && decoded.layers.count() == 1) {
+      decoded.mipChain = true;
+      while (size.width() > 1 || size.height() > 1) {
+        size = QSize(qMax(1, size.width() / 2), qMax(1, size.height() / 2));
+        decoded.layers << decoded.layers.last().scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                                               .convertToFormat(QImage::Format_RGBA8888);
+      }
+    }
+    _loader->finishDecode(decoded);
+  }
+
+private:
+  bool openCompressed(Decoded *decoded)
+  {
+    if (_compressedFormats.isEmpty()) {
+      return false;
+    }
+    const QString fileName = _compressedDirectory + QLatin1Char('/') + QFileInfo(_imagePaths.first()).completeBaseName() + QStringLiteral(".ktx");
+    if (!QFileInfo::exists(fileName)) {
+      return false;
+    }
+
+    QSharedPointer<KtxFile> file(new KtxFile);
+    if (!file->open(fileName)) {
+      qWarning() << "Could not load compressed texture" << file->errorString();
+      return false;
+    }
+    if (!_compressedFormats.contains(file->internalFormat())) {
+      qDebug("Compressed format 0x%x of %s is not supported, decoding the image instead", file->internalFormat(), qPrintable(fileName));
+      return false;
+    }
+    decoded->compressed = file;
+    return true;
+  }
+
+  TextureLoader *_loader;
+  QString _key;
+  QStringList _imagePaths;
+  QVector<GLint> _compressedFormats;
+  bool _mipChain;
+};
+
+TextureLoader::TextureLoader(GpuMemory *memory, QObject *parent)
+  : QObject(parent),
+    _memory(memory),
+    _lastEvictionPass(0),
+    _lastStreamPass(0),
+    _overBudgetWarned(false),
+    _compressedFormatsQueried(false)
+{
+  _clock.start();
+}
+
+TextureLoader::~TextureLoader()
+{
+  //the tasks call back into the loader
+  _pool.clear();
+  _pool.waitForDone();
+}
+
+QString TextureLoader::compressedDirectory()
+{
+  return _compressedDirectory;
+}
+
+void TextureLoader::setCompressedDirectory(const QString &directory)
+{
+  _compressedDirectory = directory;
+}
+
+QVector<GLint> TextureLoader::compressedFormats()
+{
+  if (_compressedFormatsQueried || _compressedDirectory.isEmpty()) {
+    return _compressedFormats;
+  }
+  _compressedFormatsQueried = true;
+
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  QOpenGLFunctions *f = context->functions();
+  GLint count = 0;
+  f->glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+  _compressedFormats.resize(count);
+  if (count > 0) {
+    f->glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, _compressedFormats.data());
+  }
+  //ETC2 and EAC are core in GLES 3.0 and GL 4.3 but not every driver lists them
+  if (context->format().version() >= (context->isOpenGLES() ? qMakePair(3, 0) : qMakePair(4, 3))) {
+    for (GLint format = GL_COMPRESSED_R11_EAC; format <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC; ++format) {
+      if (!_compressedFormats.contains(format)) {
+        _compressedFormats << format;
+      }
+    }
+  }
+  return _compressedFormats;
+}
+
+QSharedPointer<QOpenGLTexture> TextureLoader::load(const QString &imagePath)
+{
+  QSharedPointer<QOpenGLTexture> texture = createTexture(imagePath, QStringList() << imagePath, false);
+  _waiting.insert(imagePath, texture);
+  _pool.start(new DecodeTask(this, imagePath, QStringList() << imagePath, compressedFormats()));
+  return texture;
+}
+
+QSharedPointer<QOpenGLTexture> TextureLoader::loadArray(const QString &key, const QStringList &imagePaths)
+{
+  QSharedPointer<QOpenGLTexture> texture = createTexture(key, imagePaths, true);
+  _waiting.insert(key, texture);
+  _pool.start(new DecodeTask(this, key, imagePaths));
+  return texture;
+}
+
+QSharedPointer<QOpenGLTexture> TextureLoader::createTexture(const QString &key, const QStringList &imagePaths, bool array)
+{
+  //untracked when the last handle goes, the memory and the loader outlive the handles
+  QSharedPointer<QOpenGLTexture> texture(new QOpenGLTexture(array ? QOpenGLTexture::Target2DArray : QOpenGLTexture::Target2D),
+                                         [this](QOpenGLTexture *texture) { forget(texture); });
+  setPlaceholder(texture.data());
+
+  Residency residency;
+  residency.key = key;
+  residency.imagePaths = imagePaths;
+  residency.texture = texture;
+  residency.lastUse = _clock.elapsed();
+  residency.evicted = false;
+  _residency.insert(texture.data(), residency);
+  _memory->track(texture.data(), GpuMemory::Texture, key, mipChainBytes(1, 1, 1, 1));
+  return texture;
+}
+
+void TextureLoader::forget(QOpenGLTexture *texture)
+{
+  _residency.remove(texture);
+  _memory->untrack(texture);
+  delete texture;
+}
+
+void TextureLoader::setPlaceholder(QOpenGLTexture *texture)
+{
+  //a single layer, sampling any other layer is clamped to it
+  const GLubyte grey[4] = { 128, 128, 128, 255 };
+  texture->destroy();
+  texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+  texture->setSize(1, 1);
+  if (texture->target() == QOpenGLTexture::Target2DArray) {
+    texture->setLayers(1);
+  }
+  texture->setMipLevels(1);
+  texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+  texture->setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, grey);
+  texture->setMinificationFilter(QOpenGLTexture::Nearest);
+  //a streamed image may have left a higher base level
+  texture->setMipBaseLevel(0);
+}
+
+qint64 TextureLoader::mipChainBytes(int width, int height, int layers, int levels)
+{
+  qint64 bytes = 0;
+  for (int level = 0; level < levels; ++level) {
+    bytes += qint64(qMax(1, width >> level)) * qMax(1, height >> level) * layers * 4;
+  }
+  return bytes;
+}
+
+qint64 TextureLoader::compressedBytes(const KtxFile &file)
+{
+  qint64 bytes = 0;
+  for (int i = 0; i < file.levels().count(); ++i) {
+    bytes += file.levels()[i].size;
+  }
+  return bytes;
+}
+
+void TextureLoader::finishDecode(const Decoded &result)
+{
+  {
+    QMutexLocker locker(&_mutex);
+    _decoded.append(result);
+  }
+  emit decoded();
+}
+
+int TextureLoader::upload(int maxUploads)
+{
+  if (_waiting.isEmpty() && _streaming.isEmpty()) {
+    return 0;
+  }
+
+  int uploads = 0;
+  //every renderer calls this each frame, the streamed images only advance once
+  if (!_streaming.isEmpty() && _clock.elapsed() - _lastStreamPass >= StreamInterval) {
+    _lastStreamPass = _clock.elapsed();
+    uploads = streamLevels(maxUploads);
+  }
+  QList<Decoded> results;
+  {
+    QMutexLocker locker(&_mutex);
+    while (!_decoded.isEmpty() && uploads + results.count() < maxUploads) {
+      results.append(_decoded.takeFirst());
+    }
+  }
+
+  int loads = 0;
+  for (int i = 0; i < results.count(); ++i) {
+    const QString &key = results[i].key;
+    QSharedPointer<QOpenGLTexture> texture = _waiting.take(key).toStrongRef();
+    if (!texture) {
+      continue;
+    }
+    if (results[i].mipChain) {
+      startStreaming(texture.data(), results[i]);
+    }
+    else if (results[i].compressed) {
+      uploadCompressed(texture.data(), *results[i].compressed);
+    }
+    else if (!results[i].layers.isEmpty()) {
+      uploadLayers(texture.data(), results[i].layers);
+    }
+    else {
+      continue;
+    }
+    ++loads;
+    emit loaded(key);
+  }
+
+  //the new textures may have taken the memory over budget, evictIdle() reports what it evicted
+  if (loads > 0 && evictIdle() == 0) {
+    _memory->report();
+  }
+  return uploads + loads;
+}
+
+bool TextureLoader::use(QOpenGLTexture *texture)
+{
+  const QHash<QOpenGLTexture *, Residency>::iterator it = _residency.find(texture);
+  if (it == _residency.end()) {
+    return false;
+  }
+  it->lastUse = _clock.elapsed();
+  if (it->evicted) {
+    //the placeholder is drawn until the image is back
+    it->evicted = false;
+    _waiting.insert(it->key, it->texture);
+    if (texture->target() == QOpenGLTexture::Target2DArray) {
+      _pool.start(new DecodeTask(this, it->key, it->imagePaths));
+    }
+    else {
+      _pool.start(new DecodeTask(this, it->key, it->imagePaths, compressedFormats(), true));
+    }
+    qCDebug(lcGpuMemory) << "Reloading evicted texture" << it->key;
+  }
+
+  //textures only become idle with time, so over budget they are looked for every now and then
+  if (!_memory->isOverBudget() || it->lastUse - _lastEvictionPass < EvictionInterval) {
+    return false;
+  }
+  return evictIdle() > 0;
+}
+
+int TextureLoader::evictIdle()
+{
+  _lastEvictionPass = _clock.elapsed();
+  int evicted = 0;
+  while (_memory->isOverBudget()) {
+    //the least recently drawn texture that holds an image and is not being loaded
+    QHash<QOpenGLTexture *, Residency>::iterator oldest = _residency.end();
+    for (QHash<QOpenGLTexture *, Residency>::iterator it = _residency.begin(); it != _residency.end(); ++it) {
+      if (it->evicted || _waiting.contains(it->key) || _lastEvictionPass - it->lastUse < MinIdleTime) {
+        continue;
+      }
+      if (oldest == _residency.end() || it->lastUse < oldest->lastUse) {
+        oldest = it;
+      }
+    }
+    if (oldest == _residency.end()) {
+      if (!_overBudgetWarned) {
+        qWarning("GPU memory budget of %lld bytes exceeded by %lld bytes of textures drawn in the last %d ms",
+                 GpuMemory::budget(), _memory->totalBytes() - GpuMemory::budget(), int(MinIdleTime));
+        _overBudgetWarned = true;
+      }
+      break;
+    }
+
+    for (int i = 0; i < _streaming.count(); ++i) {
+      if (_streaming[i].key == oldest->key) {
+        _streaming.removeAt(i);
+        break;
+      }
+    }
+    setPlaceholder(oldest.key());
+    _memory->track(oldest.key(), GpuMemory::Texture, oldest->key, mipChainBytes(1, 1, 1, 1));
+    oldest->evicted = true;
+    ++evicted;
+    qCDebug(lcGpuMemory) << "Evicted texture" << oldest->key << "not drawn for" << _lastEvictionPass - oldest->lastUse << "ms";
+  }
+
+  if (!_memory->isOverBudget()) {
+    _overBudgetWarned = false;
+  }
+  if (evicted > 0) {
+    _memory->report();
+  }
+  return evicted;
+}
+
+void TextureLoader::uploadLayers(QOpenGLTexture *texture, const Layers &layers)
+{
+  const bool array = texture->target() == QOpenGLTexture::Target2DArray;
+  const int width = layers.first().width();
+  const int height = layers.first().height();
+
+  //storage is immutable, so the placeholder is replaced by a new texture object under the same handle
+  texture->destroy();
+  texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+  texture->setSize(width, height);
+  if (array) {
+    texture->setLayers(layers.count());
+  }
+  texture->setMipLevels(texture->maximumMipLevels());
+  texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+  texture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
+  texture->setMagnificationFilter(QOpenGLTexture::Linear);
+
+  //the copy into the PBO returns right away, the transfer to the texture is left to the driver
+  const int layerBytes = width * height * 4;
+  const int bytes = layerBytes * layers.count();
+  QOpenGLBuffer pixelBuffer(QOpenGLBuffer::PixelUnpackBuffer);
+  pixelBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+  pixelBuffer.create();
+  pixelBuffer.bind();
+  pixelBuffer.allocate(bytes);
+  char *mapped = static_cast<char *>(pixelBuffer.mapRange(0, bytes, QOpenGLBuffer::RangeWrite | QOpenGLBuffer::RangeInvalidateBuffer));
+  for (int i = 0; i < layers.count(); ++i) {
+    if (mapped) {
+      memcpy(mapped + i * layerBytes, layers[i].constBits(), layerBytes);
+    }
+    else {
+      pixelBuffer.write(i * layerBytes, layers[i].constBits(), layerBytes);
+    }
+  }
+  if (mapped) {
+    pixelBuffer.unmap();
+  }
+
+  QOpenGLExtraFunctions *f = QOpenGLContext::currentContext()->extraFunctions();
+  texture->bind();
+  for (int i = 0; i < layers.count(); ++i) {
+    const void *offset = reinterpret_cast<const void *>(qintptr(i * layerBytes));
+    if (array) {
+      f->glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+    }
+    else {
+      f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+    }
+  }
+  pixelBuffer.release();
+  pixelBuffer.destroy();
+  texture->generateMipMaps();
+  texture->release();
+  _memory->track(texture, GpuMemory::Texture, _residency.value(texture).key,
+                 mipChainBytes(width, height, layers.count(), texture->mipLevels()));
+}
+
+int TextureLoader::Streaming::levelCount() const
+{
+  return compressed ? compressed->levels().count() : levels.count();
+}
+
+QSize TextureLoader::Streaming::levelSize(int level) const
+{
+  if (compressed) {
+    return QSize(compressed->levels()[level].width, compressed->levels()[level].height);
+  }
+  return levels[level].size();
+}
+
+void TextureLoader::Streaming::upload(QOpenGLTexture *texture, int level) const
+{
+  if (compressed) {
+    texture->setCompressedData(level, compressed->levels()[level].size, compressed->levels()[level].data);
+  }
+  else {
+    texture->setData(level, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, levels[level].constBits());
+  }
+}
+
+void TextureLoader::startStreaming(QOpenGLTexture *texture, const Decoded &decoded)
+{
+  Streaming streaming;
+  streaming.key = decoded.key;
+  streaming.texture = _residency.value(texture).texture;
+  streaming.levels = decoded.layers;
+  streaming.compressed = decoded.compressed;
+  const int levelCount = streaming.levelCount();
+  const QSize size = streaming.levelSize(0);
+
+  texture->destroy();
+  if (streaming.compressed) {
+    texture->setFormat(QOpenGLTexture::TextureFormat(streaming.compressed->internalFormat()));
+  }
+  else {
+    texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+  }
+  texture->setSize(size.width(), size.height());
+  texture->setMipLevels(levelCount);
+  if (streaming.compressed) {
+    texture->allocateStorage();
+  }
+  else {
+    texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+  }
+  texture->setMipMaxLevel(levelCount - 1);
+  texture->setMinificationFilter(levelCount > 1 ? QOpenGLTexture::LinearMipMapLinear : QOpenGLTexture::Linear);
+  texture->setMagnificationFilter(QOpenGLTexture::Linear);
+  //the storage of every level exists from now on
+  _memory->track(texture, GpuMemory::Texture, decoded.key,
+                 streaming.compressed ? compressedBytes(*streaming.compressed)
+                                      : mipChainBytes(size.width(), size.height(), 1, levelCount));
+
+  //the levels up to StreamedTopSize right away, sampling is clamped to the base level
+  streaming.level = levelCount;
+  do {
+    --streaming.level;
+    streaming.upload(texture, streaming.level);
+  } while (streaming.level > 0 && qMax(streaming.levelSize(streaming.level - 1).width(),
+                                       streaming.levelSize(streaming.level - 1).height()) <= StreamedTopSize);
+  texture->setMipBaseLevel(streaming.level);
+  if (streaming.level > 0) {
+    _streaming.append(streaming);
+  }
+}
+
+int TextureLoader::streamLevels(int maxUploads)
+{
+  int uploads = 0;
+  //each image advances at most once a pass and goes to the back, so all of them get their turn
+  for (int pending = _streaming.count(); pending > 0 && uploads < maxUploads; --pending) {
+    Streaming streaming = _streaming.takeFirst();
+    QSharedPointer<QOpenGLTexture> texture = streaming.texture.toStrongRef();
+    if (!texture) {
+      continue;
+    }
+
+    --streaming.level;
+    streaming.upload(texture.data(), streaming.level);
+    texture->setMipBaseLevel(streaming.level);
+    ++uploads;
+    emit loaded(streaming.key);
+    if (streaming.level > 0) {
+      _streaming.append(streaming);
+    }
+  }
+  return uploads;
+}
+
+void TextureLoader::uploadCompressed(QOpenGLTexture *texture, const KtxFile &file)
+{
+  //straight from the mapping, the mip chain comes with the file; going through QOpenGLTexture keeps
+  //its size, format and levels right for whoever asks it later
+  const QVector<KtxFile::Level> &levels = file.levels();
+  texture->destroy();
+  texture->setFormat(QOpenGLTexture::TextureFormat(file.internalFormat()));
+  texture->setSize(levels.first().width, levels.first().height);
+  texture->setMipLevels(levels.count());
+  texture->allocateStorage();
+  for (int i = 0; i < levels.count(); ++i) {
+    texture->setCompressedData(i, levels[i].size, levels[i].data);
+  }
+  texture->setMipMaxLevel(levels.count() - 1);
+  texture->setMinificationFilter(levels.count() > 1 ? QOpenGLTexture::LinearMipMapLinear : QOpenGLTexture::Linear);
+  texture->setMagnificationFilter(QOpenGLTexture::Linear);
+  _memory->track(texture, GpuMemory::Texture, _residency.value(texture).key, compressedBytes(file));
+}
@@ -0,0 +1,204 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <QWeakPointer>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLTexture);
+
+class GpuMemory;
+class KtxFile;
+
+// Loads images into textures without blocking the GUI thread. Images are decoded and flipped on
+// a thread pool; the GL upload goes through a pixel buffer object and happens in upload(), which
+// the renderers call with a context current, a few textures per frame. Until then the texture
+// holds a 1x1 placeholder.
+//
+// Several images can also be packed into the layers of one GL_TEXTURE_2D_ARRAY; they are scaled
+// to the size of the largest one.
+//
+// If compressedDirectory() holds <name>.ktx for an image <name>.png in a compressed format the
+// context supports, the mapped file is uploaded level by level with setCompressedData()
+// instead, skipping both the decode and the mipmap generation.
+//
+// The size of every texture is tracked in a GpuMemory. Renderers call use() for the texture they
+// draw; while the memory is over its budget the textures not drawn for MinIdleTime are evicted,
+// least recently drawn first, back to the placeholder. An evicted texture is loaded again the next
+// time it is drawn. Images and KTX files are then streamed coarsest level first: the small levels
+// are uploaded at once and the finer ones one per frame, so the texture is blurred for a few
+// frames rather than missing.
+class TextureLoader : public QObject
+{
+  Q_OBJECT
+
+public:
+  // memory tracks the textures and holds the budget, it must outlive the loader
+  explicit TextureLoader(GpuMemory *memory, QObject *parent = 0);
+  ~TextureLoader();
+
+  // needs a current context, the returned texture is a placeholder until its image is uploaded
+  QSharedPointer<QOpenGLTexture> load(const QString &imagePath);
+  // as load(), with layer i of the array holding imagePaths[i]; key identifies the array in loaded()
+  QSharedPointer<QOpenGLTexture> loadArray(const QString &key, const QStringList &imagePaths);
+  // needs a current context of the share group, uploads at most maxUploads decoded images or
+  // streamed levels and returns how many it uploaded; leaves the texture bindings changed if
+  // there were any
+  int upload(int maxUploads);
+  // needs a current context of the share group, called for a texture of this loader when it is
+  // drawn: reloads it if it was evicted and evicts idle textures while over budget. Returns true
+  // if it evicted any, which leaves the texture bindings changed.
+  bool use(QOpenGLTexture *texture);
+  // images that are still being decoded, waiting for upload or streaming their levels
+  int pendingCount() const { return _waiting.count() + _streaming.count(); }
+
+  // where the KTX files built by "qmake CONFIG+=ktx" are looked up, empty to always decode the images
+  static QString compressedDirectory();
+  static void setCompressedDirectory(const QString &directory);
+
+signals:
+  // emitted from a pool thread when an image is ready for upload()
+  void decoded();
+  void loaded(const QString &key);
+
+private:
+  // milliseconds a texture must not have been drawn for before it can be evicted, so the
+  // textures on screen are not evicted and reloaded over and over; between eviction passes
+  enum { MinIdleTime = 1000, EvictionInterval = 100 };
+  // images are streamed from the first level this wide and high, a finer level every
+  // StreamInterval milliseconds however many renderers call upload() in a frame
+  enum { StreamedTopSize = 64, StreamInterval = 10 };
+
+  class DecodeTask;
+  friend class DecodeTask;
+
+  typedef QVector<QImage> Layers;
+
+  // the result of a DecodeTask, either decoded images or an opened KTX file
+  struct Decoded
+  {
+    Decoded() : mipChain(false) {}
+
+    QString key;
+    // the layers of an array, or with mipChain the mip levels of an image, finest first
+    Layers layers;
+    bool mipChain;
+    QSharedPointer<KtxFile> compressed;
+  };
+
+  // a texture loaded by this loader, by its object
+  struct Residency
+  {
+    QString key;
+    QStringList imagePaths;
+    QWeakPointer<QOpenGLTexture> texture;
+    qint64 lastUse;
+    bool evicted;
+  };
+
+  // an image whose finer levels are still to be uploaded
+  struct Streaming
+  {
+    int levelCount() const;
+    QSize levelSize(int level) const;
+    void upload(QOpenGLTexture *texture, int level) const;
+
+    QString key;
+    QWeakPointer<QOpenGLTexture> texture;
+    // the mip levels of a decoded image, finest first, or the KTX file holding them
+    Layers levels;
+    QSharedPointer<KtxFile> compressed;
+    // the finest level uploaded so far, the base level of the texture
+    int level;
+  };
+
+  // a placeholder tracked under key, a GL_TEXTURE_2D_ARRAY with array
+  QSharedPointer<QOpenGLTexture> createTexture(const QString &key, const QStringList &imagePaths, bool array);
+  // the deleter of the textures
+  void forget(QOpenGLTexture *texture);
+  void finishDecode(const Decoded &result);
+  void uploadLayers(QOpenGLTexture *texture, const Layers &layers);
+  void uploadCompressed(QOpenGLTexture *texture, const KtxFile &file);
+  void startStreaming(QOpenGLTexture *texture, const Decoded &decoded);
+  // uploads the next level of at most maxUploads streamed images, returns the number of levels uploaded
+  int streamLevels(int maxUploads);
+  // evicts the least recently drawn idle textures until the memory is within budget, returns
+  // the number evicted
+  int evictIdle();
+  QVector<GLint> compressedFormats();
+
+  // a 1x1 grey image, of one layer for an array
+  static void setPlaceholder(QOpenGLTexture *texture);
+  static qint64 mipChainBytes(int width, int height, int layers, int levels);
+  static qint64 compressedBytes(const KtxFile &file);
+
+  GpuMemory *_memory;
+  QThreadPool _pool;
+  QHash<QString, QWeakPointer<QOpenGLTexture> > _waiting;
+  QHash<QOpenGLTexture *, Residency> _residency;
+  QList<Streaming> _streaming;
+  QElapsedTimer _clock;
+  qint64 _lastEvictionPass;
+  qint64 _lastStreamPass;
+  bool _overBudgetWarned;
+  QVector<GLint> _compressedFormats;
+  bool _compressedFormatsQueried;
+  //written by the pool threads
+  QMutex _mutex;
+  QList<Decoded> _decoded;
+
+  static QString _compressedDirectory;
+};
+
+#endif
@@ -0,0 +1,135 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QMouseEvent>
+#include <QPlatformSurfaceEvent>
+
+#include "GridWindow.h"
+#include "RenderThread.h"
+#include "ThreadedWindow.h"
+
+ThreadedWindow::ThreadedWindow(int rows, int columns)
+  : _rows(qMax(1, rows)),
+    _columns(qMax(1, columns)),
+    _renderThread(new RenderThread(this, _rows, _columns)),
+    _currentTile(0),
+    _pressedTile(-1),
+    _rotationSpeed(2)
+{
+  setSurfaceType(QWindow::OpenGLSurface);
+  setTitle(tr("Textures"));
+  resize(qMin(200 * _columns, 1600), qMin(200 * _rows, 1000));
+}
+
+ThreadedWindow::~ThreadedWindow()
+{
+  delete _renderThread;
+}
+
+bool ThreadedWindow::event(QEvent *event)
+{
+  //the render thread must be done with the surface before it goes away
+  if (event->type() == QEvent::PlatformSurface
+      && static_cast<QPlatformSurfaceEvent *>(event)->surfaceEventType() == QPlatformSurfaceEvent::SurfaceAboutToBeDestroyed) {
+    _renderThread->stop();
+  }
+  return QWindow::event(event);
+}
+
+void ThreadedWindow::exposeEvent(QExposeEvent * /* event */)
+{
+  _renderThread->post(RenderThread::Command(RenderThread::Command::Expose, 0, isExposed()));
+  if (isExposed() && !_renderThread->isRunning()) {
+    postSize();
+    _renderThread->start();
+  }
+}
+
+void ThreadedWindow::resizeEvent(QResizeEvent * /* event */)
+{
+  postSize();
+}
+
+void ThreadedWindow::postSize()
+{
+  const QSize pixels = size() * devicePixelRatio();
+  _renderThread->post(RenderThread::Command(RenderThread::Command::Resize, 0, pixels.width(), pixels.height()));
+}
+
+void ThreadedWindow::mousePressEvent(QMouseEvent *event)
+{
+  _pressedTile = GridWindow::tileAt(event->pos(), _rows, _columns, size());
+  _lastPos = event->pos();
+}
+
+void ThreadedWindow::mouseMoveEvent(QMouseEvent *event)
+{
+  if (_pressedTile < 0) {
+    return;
+  }
+
+  int dx = event->x() - _lastPos.x();
+  int dy = event->y() - _lastPos.y();
+
+  if (event->buttons() & Qt::LeftButton) {
+    _renderThread->post(RenderThread::Command(RenderThread::Command::Rotate, _pressedTile, 8 * dy, 8 * dx, 0));
+  } else if (event->buttons() & Qt::RightButton) {
+    _renderThread->post(RenderThread::Command(RenderThread::Command::Rotate, _pressedTile, 8 * dy, 0, 8 * dx));
+  }
+  _lastPos = event->pos();
+}
+
+void ThreadedWindow::mouseReleaseEvent(QMouseEvent * /* event */)
+{
+  if (_pressedTile < 0) {
+    return;
+  }
+
+  if (_pressedTile == _currentTile) {
+    _renderThread->post(RenderThread::Command(RenderThread::Command::ToggleRotationIndex, _currentTile));
+    _rotationSpeed = (_rotationSpeed == 2) ? 8 : 2;
+  }
+  else {
+    _currentTile = _pressedTile;
+    _rotationSpeed = 2;
+  }
+  _renderThread->post(RenderThread::Command(RenderThread::Command::SetCurrent, _currentTile, _rotationSpeed));
+  _pressedTile = -1;
+}
@@ -0,0 +1,381 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtGlobal>
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+//the AVX2 kernel is compiled for AVX2 on its own and only called if the CPU has it
+#define TRANSFORM_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "TransformBatch.h"
+
+TransformBatch::Kernel TransformBatch::_selectedKernel = TransformBatch::bestKernel();
+
+static const char *kernelNameTable[] = { "scalar", "sse2", "avx2", "neon" };
+
+namespace {
+
+struct InstanceArrays
+{
+  const float *x;
+  const float *y;
+  const float *z;
+  const float *scale;
+  const float *xAngle;
+  const float *yAngle;
+  const float *zAngle;
+};
+
+// instances [first, count) with the C library sine and cosine, also the tail of the SIMD kernels
+void transformScalar(const InstanceArrays &in, int first, int count, const float offset[3], float *out, int stride)
+{
+  for (int i = first; i < count; ++i) {
+    const float ax = in.xAngle[i] + offset[0];
+    const float ay = in.yAngle[i] + offset[1];
+    const float az = in.zAngle[i] + offset[2];
+    const float sa = sinf(ax), ca = cosf(ax);
+    const float sb = sinf(ay), cb = cosf(ay);
+    const float sc = sinf(az), cc = cosf(az);
+    const float s = in.scale[i];
+
+    float *m = out + i * stride;
+    m[0] = s * cb * cc;
+    m[1] = s * (sa * sb * cc + ca * sc);
+    m[2] = s * (sa * sc - ca * sb * cc);
+    m[3] = 0.0f;
+    m[4] = -s * cb * sc;
+    m[5] = s * (ca * cc - sa * sb * sc);
+    m[6] = s * (ca * sb * sc + sa * cc);
+    m[7] = 0.0f;
+    m[8] = s * sb;
+    m[9] = -s * sa * cb;
+    m[10] = s * ca * cb;
+    m[11] = 0.0f;
+    m[12] = in.x[i];
+    m[13] = in.y[i];
+    m[14] = in.z[i];
+    m[15] = 1.0f;
+  }
+}
+
+}
+
+#ifdef TRANSFORM_SSE2
+namespace sse2 {
+
+typedef __m128 V;
+enum { Width = 4 };
+#define TRANSFORM_TARGET
+
+static inline V set1(float value) { return _mm_set1_ps(value); }
+static inline V load(const float *p) { return _mm_loadu_ps(p); }
+static inline V add(V a, V b) { return _mm_add_ps(a, b); }
+static inline V sub(V a, V b) { return _mm_sub_ps(a, b); }
+static inline V mul(V a, V b) { return _mm_mul_ps(a, b); }
+static inline V min(V a, V b) { return _mm_min_ps(a, b); }
+static inline V max(V a, V b) { return _mm_max_ps(a, b); }
+static inline V round(V a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+static inline void storeColumns(float *out, int stride, V a, V b, V c, V d)
+{
+  _MM_TRANSPOSE4_PS(a, b, c, d);
+  _mm_storeu_ps(out, a);
+  _mm_storeu_ps(out + stride, b);
+  _mm_storeu_ps(out + 2 * stride, c);
+  _mm_storeu_ps(out + 3 * stride, d);
+}
+
+#include "TransformKernel.inc"
+#undef TRANSFORM_TARGET
+
+}
+#endif
+
+#ifdef TRANSFORM_AVX2
+namespace avx2 {
+
+typedef __m256 V;
+enum { Width = 8 };
+#ifdef _MSC_VER
+#define TRANSFORM_TARGET
+#else
+#define TRANSFORM_TARGET __attribute__((target("avx2")))
+#endif
+
+static inline TRANSFORM_TARGET V set1(float value) { return _mm256_set1_ps(value); }
+static inline TRANSFORM_TARGET V load(const float *p) { return _mm256_loadu_ps(p); }
+static inline TRANSFORM_TARGET V add(V a, V b) { return _mm256_add_ps(a, b); }
+static inline TRANSFORM_TARGET V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+static inline TRANSFORM_TARGET V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+static inline TRANSFORM_TARGET V min(V a, V b) { return _mm256_min_ps(a, b); }
+static inline TRANSFORM_TARGET V max(V a, V b) { return _mm256_max_ps(a, b); }
+static inline TRANSFORM_TARGET V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+static inline TRANSFORM_TARGET void storeColumns(float *out, int stride, V a, V b, V c, V d)
+{
+  //two 4x4 transposes, lanes 0-3 and 4-7
+  for (int half = 0; half < 2; ++half) {
+    __m128 a4 = half ? _mm256_extractf128_ps(a, 1) : _mm256_castps256_ps128(a);
+    __m128 b4 = half ? _mm256_extractf128_ps(b, 1) : _mm256_castps256_ps128(b);
+    __m128 c4 = half ? _mm256_extractf128_ps(c, 1) : _mm256_castps256_ps128(c);
+    __m128 d4 = half ? _mm256_extractf128_ps(d, 1) : _mm256_castps256_ps128(d);
+    _MM_TRANSPOSE4_PS(a4, b4, c4, d4);
+    float *lanes = out + 4 * half * stride;
+    _mm_storeu_ps(lanes, a4);
+    _mm_storeu_ps(lanes + stride, b4);
+    _mm_storeu_ps(lanes + 2 * stride, c4);
+    _mm_storeu_ps(lanes + 3 * stride, d4);
+  }
+}
+
+#include "TransformKernel.inc"
+#undef TRANSFORM_TARGET
+
+}
+#endif
+
+#ifdef TRANSFORM_NEON
+namespace neon {
+
+typedef float32x4_t V;
+enum { Width = 4 };
+#define TRANSFORM_TARGET
+
+static inline V set1(float value) { return vdupq_n_f32(value); }
+static inline V load(const float *p) { return vld1q_f32(p); }
+static inline V add(V a, V b) { return vaddq_f32(a, b); }
+static inline V sub(V a, V b) { return vsubq_f32(a, b); }
+static inline V mul(V a, V b) { return vmulq_f32(a, b); }
+static inline V min(V a, V b) { return vminq_f32(a, b); }
+static inline V max(V a, V b) { return vmaxq_f32(a, b); }
+static inline V round(V a)
+{
+  //ARMv7 only converts with truncation, so add 0.5 with the sign of a first
+  const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(a), vdupq_n_u32(0x80000000));
+  const V half = vreinterpretq_f32_u32(vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+  return vcvtq_f32_s32(vcvtq_s32_f32(vaddq_f32(a, half)));
+}
+static inline void storeColumns(float *out, int stride, V a, V b, V c, V d)
+{
+  //an interleaving store is a transpose
+  float columns[16];
+  float32x4x4_t rows = { { a, b, c, d } };
+  vst4q_f32(columns, rows);
+  for (int lane = 0; lane < 4; ++lane) {
+    memcpy(out + lane * stride, columns + 4 * lane, 4 * sizeof(float));
+  }
+}
+
+#include "TransformKernel.inc"
+#undef TRANSFORM_TARGET
+
+}
+#endif
+
+static bool cpuHasAvx2()
+{
+#if defined(TRANSFORM_AVX2) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  //the OS has to save the YMM registers too
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#elif defined(TRANSFORM_AVX2)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+TransformBatch::TransformBatch()
+  : _count(0)
+{
+}
+
+void TransformBatch::resize(int count)
+{
+  _count = qMax(0, count);
+  const int padded = (_count + Padding - 1) / Padding * Padding;
+  QVector<float> *arrays[] = { &_x, &_y, &_z, &_scale, &_xAngle, &_yAngle, &_zAngle };
+  for (int i = 0; i < 7; ++i) {
+    arrays[i]->fill(0.0f, padded);
+  }
+}
+
+void TransformBatch::setInstance(int index, const QVector3D &translation, float scale, const QVector3D &angles)
+{
+  Q_ASSERT(index >= 0 && index < _count);
+  _x[index] = translation.x();
+  _y[index] = translation.y();
+  _z[index] = translation.z();
+  _scale[index] = scale;
+  _xAngle[index] = qDegreesToRadians(angles.x());
+  _yAngle[index] = qDegreesToRadians(angles.y());
+  _zAngle[index] = qDegreesToRadians(angles.z());
+}
+
+void TransformBatch::compute(int first, int count, const QVector3D &angleOffset, float *matrices, int stride, Kernel kernel) const
+{
+  Q_ASSERT(first >= 0 && first + count <= _count);
+  const InstanceArrays in = {
+    _x.constData() + first, _y.constData() + first, _z.constData() + first, _scale.constData() + first,
+    _xAngle.constData() + first, _yAngle.constData() + first, _zAngle.constData() + first
+  };
+  //large offsets lose precision in the reduction, keep them within one turn
+  const float offset[3] = {
+    qDegreesToRadians(float(fmod(angleOffset.x(), 360.0))),
+    qDegreesToRadians(float(fmod(angleOffset.y(), 360.0))),
+    qDegreesToRadians(float(fmod(angleOffset.z(), 360.0)))
+  };
+
+  int done = 0;
+  switch (isSupported(kernel) ? kernel : Scalar) {
+#ifdef TRANSFORM_SSE2
+  case Sse2:
+    done = sse2::transform(in, count, offset, matrices, stride);
+    break;
+#endif
+#ifdef TRANSFORM_AVX2
+  case Avx2:
+    done = avx2::transform(in, count, offset, matrices, stride);
+    break;
+#endif
+#ifdef TRANSFORM_NEON
+  case Neon:
+    done = neon::transform(in, count, offset, matrices, stride);
+    break;
+#endif
+  default:
+    break;
+  }
+  transformScalar(in, done, count, offset, matrices, stride);
+}
+
+bool TransformBatch::isSupported(Kernel kernel)
+{
+  switch (kernel) {
+  case Scalar:
+    return true;
+#ifdef TRANSFORM_SSE2
+  case Sse2:
+    return true;
+#endif
+#ifdef TRANSFORM_AVX2
+  case Avx2: {
+    static const bool avx2 = cpuHasAvx2();
+    return avx2;
+  }
+#endif
+#ifdef TRANSFORM_NEON
+  case Neon:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+TransformBatch::Kernel TransformBatch::bestKernel()
+{
+  const Kernel preferred[] = { Avx2, Sse2, Neon };
+  for (int i = 0; i < 3; ++i) {
+    if (isSupported(preferred[i])) {
+      return preferred[i];
+    }
+  }
+  return Scalar;
+}
+
+TransformBatch::Kernel TransformBatch::selectedKernel()
+{
+  return _selectedKernel;
+}
+
+void TransformBatch::setSelectedKernel(Kernel kernel)
+{
+  _selectedKernel = kernel;
+}
+
+QString TransformBatch::kernelName(Kernel kernel)
+{
+  return QString::fromLatin1(kernelNameTable[kernel]);
+}
+
+bool TransformBatch::kernelFromName(const QString &name, Kernel *kernel)
+{
+  for (int i = 0; i < KernelCount; ++i) {
+    if (name.compare(QLatin1String(kernelNameTable[i]), Qt::CaseInsensitive) == 0) {
+      *kernel = static_cast<Kernel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+QStringList TransformBatch::kernelNames()
+{
+  QStringList names;
+  for (int i = 0; i < KernelCount; ++i) {
+    names << QString::fromLatin1(kernelNameTable[i]);
+  }
+  return names;
+}
@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** You may use this file under the terms of the BSD license as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of Digia Plc and its Subsidiary(-ies) nor the names
+**     of its contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef TRANSFORMBATCH_H
+#define TRANSFORMBATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QVector3D>
+
+// Model matrices of many instances, computed a whole batch at a time. The per-instance state
+// (translation, uniform scale and base rotation angles) is kept as a structure of arrays so that
+// the SIMD kernels load one vector per quantity; every instance gets
+//   translate(translation) * scale(scale) * rotate(x) * rotate(y) * rotate(z)
+// as with the QMatrix4x4 calls, the angles being the instance's own plus a shared offset.
+// The column-major matrices are written straight into the parameter records.
+//
+// The kernel is chosen at runtime: AVX2 if the CPU has it, SSE2 on other x86 CPUs, NEON on ARM
+// and plain C++ elsewhere.
+class TransformBatch
+{
+public:
+  enum Kernel {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon,
+    KernelCount
+  };
+
+  TransformBatch();
+
+  int count() const { return _count; }
+  void resize(int count);
+  // angles in degrees
+  void setInstance(int index, const QVector3D &translation, float scale, const QVector3D &angles);
+
+  // writes the matrix of instance i to matrices + i * stride, angleOffset in degrees
+  void compute(const QVector3D &angleOffset, float *matrices, int stride, Kernel kernel = selectedKernel()) const
+  { compute(0, _count, angleOffset, matrices, stride, kernel); }
+  // only instances [first, first + count), the matrix of instance first goes to matrices. Safe to
+  // call from several threads at once for different ranges.
+  void compute(int first, int count, const QVector3D &angleOffset, float *matrices, int stride,
+               Kernel kernel = selectedKernel()) const;
+
+  static bool isSupported(Kernel kernel);
+  // the fastest kernel this CPU supports
+  static Kernel bestKernel();
+  static Kernel selectedKernel();
+  static void setSelectedKernel(Kernel kernel);
+
+  static QString kernelName(Kernel kernel);
+  static bool kernelFromName(const QString &name, Kernel *kernel);
+  static QStringList kernelNames();
+
+private:
+  // the arrays are padded to a multiple of the widest kernel
+  enum { Padding = 8 };
+
+  int _count;
+  QVector<float> _x;
+  QVector<float> _y;
+  QVector<float> _z;
+  QVector<float> _scale;
+  //radians
+  QVector<float> _xAngle;
+  QVector<float> _yAngle;
+  QVector<float> _zAngle;
+
+  static Kernel _selectedKernel;
+};
+
+#endif
@@ -40,6 +40,7 @@
 
 #include <QtWidgets>
 
+#include "AnimationScheduler.h"
 #include "GLWidget.h"
 #include "Window.h"
 
@@ -66,9 +67,11 @@ Window::Window()
 
   currentGlWidget = glWidgets[0][0];
 
-  QTimer *timer = new QTimer(this);
-  connect(timer, SIGNAL(timeout()), this, SLOT(rotateOneStep()));
-  timer->start(20);
+  animation = new AnimationScheduler(this);
+  animation->setSurface(currentGlWidget);
+  animation->setStepAngle(rotationSpeed * 16);
+  connect(animation, SIGNAL(advance(int)), this, SLOT(rotateCurrent(int)));
+  animation->start();
 
   setWindowTitle(tr("Textures"));
 }
@@ -85,11 +88,13 @@ void Window::setCurrentGlWidget()
   else {
     rotationSpeed = 2;
   }
+  animation->setSurface(currentGlWidget);
+  animation->setStepAngle(rotationSpeed * 16);
 }
 
-void Window::rotateOneStep()
+void Window::rotateCurrent(int angle)
 {
   if (currentGlWidget) {
-    currentGlWidget->rotateBy(rotationSpeed * 16, rotationSpeed * 16, -1 * rotationSpeed * 16);
+    currentGlWidget->rotateBy(angle, angle, -1 * angle);
   }
 }
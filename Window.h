@@ -43,6 +43,7 @@
 
 #include <QWidget>
 
+class AnimationScheduler;
 class GLWidget;
 
 class Window : public QWidget
@@ -54,7 +55,7 @@ public:
 
 private slots:
   void setCurrentGlWidget();
-  void rotateOneStep();
+  void rotateCurrent(int angle);
 
 private:
   enum { NumRows = 3, NumColumns = 2 };
@@ -63,6 +64,8 @@ private:
   GLWidget *currentGlWidget;
   GLWidget *previousGlWidget;
   int rotationSpeed;
+  //follows the frames of the current widget
+  AnimationScheduler *animation;
 };
 
 #endif
@@ -39,27 +39,258 @@
 ****************************************************************************/
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QScopedPointer>
 #include <QSurfaceFormat>
 #include <QOpenGLContext>
 
+#include <string.h>
+
+#include "Benchmark.h"
+#include "CubeRenderer.h"
+#include "FrameCapture.h"
+#include "FramePipeline.h"
+#include "FrameStatistics.h"
+#include "GpuMemory.h"
+#include "GpuProfiler.h"
+#include "GridWindow.h"
+#include "InputLatency.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "ParameterEncoding.h"
+#include "ParameterStorage.h"
+#include "ProgramCache.h"
+#include "ShaderCompiler.h"
+#include "TextureLoader.h"
+#include "ThreadedWindow.h"
+#include "TransformBatch.h"
 #include "Window.h"
 
+static bool hasArgument(int argc, char *argv[], const char *name)
+{
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 int main(int argc, char *argv[])
 {
+  ShaderCompiler::startTiming();
   Q_INIT_RESOURCE(textures);
+  //lets all GLWidgets share one copy of the programs, textures and mesh buffers
+  QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
 
-  QApplication app(argc, argv);
+  //the benchmark does not create any widgets, so it can run without a windowing system
+  const bool benchmark = hasArgument(argc, argv, "--benchmark") || hasArgument(argc, argv, "--transform-benchmark");
+  QScopedPointer<QGuiApplication> app(benchmark ? new QGuiApplication(argc, argv) : new QApplication(argc, argv));
 
-  QSurfaceFormat format;
-  if (QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGL) {
-    format.setVersion( 3, 2 );
+  QCommandLineParser parser;
+  parser.setApplicationDescription("UBO's and textures as shader parameter storage mechanisms");
+  parser.addHelpOption();
+  QCommandLineOption storageOption("storage",
+                                   QString("Shader parameter storage backend: %1. Overrides TEXTURES_STORAGE.")
+                                     .arg(ParameterStorage::backendNames().join(", ")),
+                                   "backend");
+  parser.addOption(storageOption);
+  QCommandLineOption encodingOption("encoding",
+                                    QString("Parameter encoding: %1 (default full). Half needs the texture or tbo backend.")
+                                      .arg(ParameterEncoding::encodingNames().join(", ")),
+                                    "encoding");
+  parser.addOption(encodingOption);
+  QCommandLineOption benchmarkOption("benchmark", "Render offscreen for every storage backend and encoding and print a JSON report.");
+  parser.addOption(benchmarkOption);
+  QCommandLineOption transformBenchmarkOption("transform-benchmark",
+                                              "Time the instance matrices of QMatrix4x4 against every SIMD kernel and print a JSON report.");
+  parser.addOption(transformBenchmarkOption);
+  QCommandLineOption transformKernelOption("transform-kernel",
+                                           QString("Kernel computing the instance matrices: %1 (default %2, the fastest one this CPU supports).")
+                                             .arg(TransformBatch::kernelNames().join(", "))
+                                             .arg(TransformBatch::kernelName(TransformBatch::bestKernel())),
+                                           "kernel");
+  parser.addOption(transformKernelOption);
+  QCommandLineOption framesOption("frames", "Number of frames to render per backend in benchmark mode.", "count", "1000");
+  parser.addOption(framesOption);
+  QCommandLineOption sizeOption("size", "Framebuffer size in pixels in benchmark mode.", "pixels", "256");
+  parser.addOption(sizeOption);
+  QCommandLineOption outputOption("output", "Write the benchmark report to a file instead of stdout.", "file");
+  parser.addOption(outputOption);
+  QCommandLineOption instancesOption("instances", "Draw a grid of this many instanced cubes per tile.", "count", "1");
+  parser.addOption(instancesOption);
+  QCommandLineOption prepareThreadsOption("prepare-threads",
+                                          QString("Worker threads preparing the instance parameters, 0 prepares them on the GUI thread (default %1).")
+                                            .arg(FramePipeline::threadCount()),
+                                          "count");
+  parser.addOption(prepareThreadsOption);
+  QCommandLineOption meshOption("mesh", "Draw the triangles of a Wavefront OBJ file instead of the cube.", "file");
+  parser.addOption(meshOption);
+  QCommandLineOption vertexFormatOption("vertex-format",
+                                        QString("Vertex format of the mesh: %1 (default float).")
+                                          .arg(Mesh::vertexFormatNames().join(", ")),
+                                        "format");
+  parser.addOption(vertexFormatOption);
+  QCommandLineOption uberShaderOption("uber-shader", "Draw every material with the uber shader instead of a program per material.");
+  parser.addOption(uberShaderOption);
+  QCommandLineOption textureArrayOption("texture-array", "Pack all cube images into one 2D array texture, selecting the layer per instance.");
+  parser.addOption(textureArrayOption);
+  QCommandLineOption ktxDirOption("ktx-dir", "Directory with precompressed KTX versions of the images, built with qmake CONFIG+=ktx.",
+                                  "directory", QCoreApplication::applicationDirPath() + "/ktx");
+  parser.addOption(ktxDirOption);
+  QCommandLineOption noKtxOption("no-ktx", "Always decode the PNG images, even if KTX versions are available.");
+  parser.addOption(noKtxOption);
+  QCommandLineOption gpuProfileOption("gpu-profile", "Time the clear, upload and draw stages with GPU timer queries (logged to textures.gpu).");
+  parser.addOption(gpuProfileOption);
+  QCommandLineOption gpuOverlayOption("gpu-overlay", "Show the GPU stage timings on top of every tile, implies --gpu-profile.");
+  parser.addOption(gpuOverlayOption);
+  QCommandLineOption shaderCacheOption("shader-cache",
+                                       QString("Directory for cached program binaries (default %1).")
+                                         .arg(ProgramCache::instance()->directory()),
+                                       "directory");
+  parser.addOption(shaderCacheOption);
+  QCommandLineOption noShaderCacheOption("no-shader-cache", "Always compile shader programs from source.");
+  parser.addOption(noShaderCacheOption);
+  QCommandLineOption syncShadersOption("sync-shaders", "Compile shader programs on the thread that draws with them, blocking it.");
+  parser.addOption(syncShadersOption);
+  QCommandLineOption singleSurfaceOption("single-surface", "Draw all tiles into one window with scissored viewports instead of one GLWidget per tile.");
+  parser.addOption(singleSurfaceOption);
+  QCommandLineOption gridOption("grid", "Tile grid of the single surface window, as columns x rows.", "columnsxrows", "2x3");
+  parser.addOption(gridOption);
+  QCommandLineOption renderThreadOption("render-thread", "Draw the single surface window from its own thread and context, implies --single-surface.");
+  parser.addOption(renderThreadOption);
+  QCommandLineOption frameStatsOption("frame-stats", "Write the frame time histograms as CSV to this file on exit (logged to textures.frames).",
+                                      "file");
+  parser.addOption(frameStatsOption);
+  QCommandLineOption lowLatencyOption("low-latency", "Keep at most one frame on the GPU and apply the mouse moves queued until a paint at once.");
+  parser.addOption(lowLatencyOption);
+  QCommandLineOption captureOption("capture", "Write every frame of every surface, or of the benchmark, as numbered PNG files to this directory.",
+                                   "directory");
+  parser.addOption(captureOption);
+  QCommandLineOption gpuBudgetOption("gpu-budget", "Evict the least recently drawn textures while the estimated GPU memory exceeds this many MiB (logged to textures.memory).",
+                                     "MiB");
+  parser.addOption(gpuBudgetOption);
+  parser.process(*app);
+
+  QString storageName = QString::fromLocal8Bit(qgetenv("TEXTURES_STORAGE"));
+  if (parser.isSet(storageOption)) {
+    storageName = parser.value(storageOption);
+  }
+  if (!storageName.isEmpty()) {
+    ParameterStorage::Backend backend;
+    if (!ParameterStorage::backendFromName(storageName, &backend)) {
+      qWarning("Unknown shader parameter storage backend '%s', expected one of: %s",
+               qPrintable(storageName), qPrintable(ParameterStorage::backendNames().join(", ")));
+      return EXIT_FAILURE;
+    }
+    ParameterStorage::setSelectedBackend(backend);
+  }
+  if (parser.isSet(encodingOption)) {
+    ParameterEncoding::Encoding encoding;
+    if (!ParameterEncoding::encodingFromName(parser.value(encodingOption), &encoding)) {
+      qWarning("Unknown parameter encoding '%s', expected one of: %s",
+               qPrintable(parser.value(encodingOption)), qPrintable(ParameterEncoding::encodingNames().join(", ")));
+      return EXIT_FAILURE;
+    }
+    ParameterEncoding::setSelectedEncoding(encoding);
   }
-  else {
-      format.setVersion(3, 0);
+  if (parser.isSet(vertexFormatOption)) {
+    Mesh::VertexFormat vertexFormat;
+    if (!Mesh::vertexFormatFromName(parser.value(vertexFormatOption), &vertexFormat)) {
+      qWarning("Unknown vertex format '%s', expected one of: %s",
+               qPrintable(parser.value(vertexFormatOption)), qPrintable(Mesh::vertexFormatNames().join(", ")));
+      return EXIT_FAILURE;
+    }
+    Mesh::setSelectedVertexFormat(vertexFormat);
   }
+  Mesh::setSelectedPath(parser.value(meshOption));
+
+  if (parser.isSet(transformKernelOption)) {
+    TransformBatch::Kernel kernel;
+    if (!TransformBatch::kernelFromName(parser.value(transformKernelOption), &kernel)) {
+      qWarning("Unknown transform kernel '%s', expected one of: %s",
+               qPrintable(parser.value(transformKernelOption)), qPrintable(TransformBatch::kernelNames().join(", ")));
+      return EXIT_FAILURE;
+    }
+    if (!TransformBatch::isSupported(kernel)) {
+      qWarning("Transform kernel '%s' is not supported by this CPU", qPrintable(parser.value(transformKernelOption)));
+      return EXIT_FAILURE;
+    }
+    TransformBatch::setSelectedKernel(kernel);
+  }
+
+  CubeRenderer::setSelectedInstanceCount(parser.value(instancesOption).toInt());
+  if (parser.isSet(prepareThreadsOption)) {
+    FramePipeline::setThreadCount(parser.value(prepareThreadsOption).toInt());
+  }
+  CubeRenderer::setTextureArrayEnabled(parser.isSet(textureArrayOption));
+  Material::setPermutationsEnabled(!parser.isSet(uberShaderOption));
+  TextureLoader::setCompressedDirectory(parser.isSet(noKtxOption) ? QString() : parser.value(ktxDirOption));
+  GpuProfiler::setEnabled(parser.isSet(gpuProfileOption) || parser.isSet(gpuOverlayOption));
+  GpuProfiler::setOverlayEnabled(parser.isSet(gpuOverlayOption));
+  InputLatency::setLowLatencyEnabled(parser.isSet(lowLatencyOption));
+  GpuMemory::setBudget(qint64(parser.value(gpuBudgetOption).toDouble() * 1024 * 1024));
+  if (parser.isSet(captureOption)) {
+    if (!QDir().mkpath(parser.value(captureOption))) {
+      qWarning("Could not create the capture directory '%s'", qPrintable(parser.value(captureOption)));
+      return EXIT_FAILURE;
+    }
+    FrameCapture::setDirectory(parser.value(captureOption));
+  }
+  if (parser.isSet(shaderCacheOption)) {
+    ProgramCache::instance()->setDirectory(parser.value(shaderCacheOption));
+  }
+  ProgramCache::instance()->setEnabled(!parser.isSet(noShaderCacheOption));
+  ShaderCompiler::setAsyncEnabled(!parser.isSet(syncShadersOption));
+
+  QSurfaceFormat format;
+  ParameterStorage::requestFormat(ParameterStorage::selectedBackend(), format);
   format.setProfile( QSurfaceFormat::CoreProfile );
   QSurfaceFormat::setDefaultFormat(format);
+
+  if (benchmark) {
+    Benchmark bench;
+    bench.setFrameCount(qMax(1, parser.value(framesOption).toInt()));
+    int side = qMax(1, parser.value(sizeOption).toInt());
+    bench.setSize(QSize(side, side));
+    bench.setOutputFile(parser.value(outputOption));
+    if (!storageName.isEmpty()) {
+      bench.setBackends(QList<ParameterStorage::Backend>() << ParameterStorage::selectedBackend());
+    }
+    if (parser.isSet(encodingOption)) {
+      bench.setEncodings(QList<ParameterEncoding::Encoding>() << ParameterEncoding::selectedEncoding());
+    }
+    if (parser.isSet(transformBenchmarkOption)) {
+      return bench.runTransforms();
+    }
+    return bench.run();
+  }
+
+  FrameStatistics::startReporting(parser.value(frameStatsOption));
+
+  if (parser.isSet(singleSurfaceOption) || parser.isSet(gridOption) || parser.isSet(renderThreadOption)) {
+    const QStringList grid = parser.value(gridOption).split('x');
+    const int columns = grid.value(0).toInt();
+    const int rows = grid.value(1).toInt();
+    if (grid.count() != 2 || columns < 1 || rows < 1) {
+      qWarning("Invalid grid '%s', expected columns x rows such as 8x6", qPrintable(parser.value(gridOption)));
+      return EXIT_FAILURE;
+    }
+    if (parser.isSet(renderThreadOption)) {
+      if (QOpenGLContext::supportsThreadedOpenGL()) {
+        ThreadedWindow window(rows, columns);
+        window.show();
+        return app->exec();
+      }
+      qWarning("The platform does not support OpenGL on other threads, rendering on the GUI thread");
+    }
+    GridWindow window(rows, columns);
+    window.show();
+    return app->exec();
+  }
+
   Window window;
   window.show();
-  return app.exec();
+  return app->exec();
 }
@@ -1,15 +1,88 @@
-HEADERS = GLWidget.h \
+HEADERS = AnimationScheduler.h \
+          Benchmark.h \
+          CubeRenderer.h \
+          CubeState.h \
+          FrameCapture.h \
+          FramePipeline.h \
+          FrameStatistics.h \
+          GLStateCache.h \
+          GLWidget.h \
+          GpuMemory.h \
+          GpuProfiler.h \
+          GridWindow.h \
+          InputLatency.h \
+          KtxFile.h \
+          Material.h \
+          Mesh.h \
+          ParameterEncoding.h \
+          ParameterLayout.h \
+          ParameterStorage.h \
+          ProgramCache.h \
+          RenderThread.h \
+          ShaderCompiler.h \
+          SharedResources.h \
+          TextureLoader.h \
+          ThreadedWindow.h \
+          TransformBatch.h \
           Window.h
-SOURCES = GLWidget.cpp \
+SOURCES = AnimationScheduler.cpp \
+          Benchmark.cpp \
+          CubeRenderer.cpp \
+          FrameCapture.cpp \
+          FramePipeline.cpp \
+          FrameStatistics.cpp \
+          GLStateCache.cpp \
+          GLWidget.cpp \
+          GpuMemory.cpp \
+          GpuProfiler.cpp \
+          GridWindow.cpp \
+          InputLatency.cpp \
+          KtxFile.cpp \
+          Material.cpp \
+          Mesh.cpp \
+          ParameterEncoding.cpp \
+          ParameterLayout.cpp \
+          ParameterStorage.cpp \
+          ProgramCache.cpp \
+          RenderThread.cpp \
+          ShaderCompiler.cpp \
+          SharedResources.cpp \
+          TextureLoader.cpp \
+          ThreadedWindow.cpp \
+          TransformBatch.cpp \
           Window.cpp \
           main.cpp
 
+DISTFILES     = Material.def \
+                ParameterLayout.def \
+                TransformKernel.inc
 RESOURCES     = textures.qrc
 QT           += opengl widgets
+CONFIG       += c++11
 
-# Uncomment this to use UBO-based shader parameter storage instead of texture-based storage
+# The shader parameter storage backend is chosen at startup with --storage or TEXTURES_STORAGE.
+# Uncomment this to make the UBO-based storage the default instead of texture-based storage
 # DEFINES += USE_UBO
 
+# "qmake CONFIG+=ktx" also converts the images to KTX files in ktx/ next to the executable, ETC2
+# compressed with a full mip chain, flipped like the runtime decode. The app loads those instead
+# of the PNGs when the GL supports the format. Pass e.g. KTX_FORMAT=BC1 for desktop GPUs without
+# ETC2, or KTX_ENCODER to use another PVRTexToolCLI.
+ktx {
+  isEmpty(KTX_ENCODER): KTX_ENCODER = PVRTexToolCLI
+  isEmpty(KTX_FORMAT): KTX_FORMAT = ETC2_RGB
+  KTX_IMAGES = $$files($$PWD/images/*.png)
+  # the quality preset only applies to the ETC and EAC encoders
+  contains(KTX_FORMAT, "^(ETC|EAC).*"): KTX_QUALITY = -q etcfast
+
+  ktx_encoder.input = KTX_IMAGES
+  ktx_encoder.output = ktx/${QMAKE_FILE_BASE}.ktx
+  ktx_encoder.commands = $$KTX_ENCODER -i ${QMAKE_FILE_NAME} -o ${QMAKE_FILE_OUT} -f $$KTX_FORMAT -m -flip y $$KTX_QUALITY
+  ktx_encoder.name = KTX ${QMAKE_FILE_IN}
+  ktx_encoder.CONFIG += no_link target_predeps
+  QMAKE_EXTRA_COMPILERS += ktx_encoder
+}
+
 # install
 target.path = $$[QT_INSTALL_EXAMPLES]/opengl/textures
 INSTALLS += target